@@ -38,27 +38,36 @@ int next_id = 1;
 
 /**
  * @brief Handler for GET /api/users - Returns list of all users
+ *
+ * The body is built in a buffer presized by the framework from the sizes this
+ * route returned before, growing it only when the user list got longer.
  */
 char *get_users_handler(void) {
-    char *response = malloc(1024);
+    size_t capacity = 0;
+    char *response = cx_response_buffer(&capacity);
     if (!response) {
-        perror("malloc failed in get_users_handler");
+        perror("cx_response_buffer failed in get_users_handler");
         return NULL;
     }
     
-    strcpy(response, "{\n  \"users\": [\n");
+    size_t len = snprintf(response, capacity, "{\n  \"users\": [\n");
     
     for (int i = 0; i < user_count; i++) {
         char user_json[200];
-        snprintf(user_json, sizeof(user_json), 
+        size_t user_len = snprintf(user_json, sizeof(user_json), 
                 "    {\n      \"id\": %d,\n      \"name\": \"%s\",\n      \"email\": \"%s\"\n    }%s\n",
                 users[i].id, users[i].name, users[i].email,
                 (i < user_count - 1) ? "," : "");
         
-        strcat(response, user_json);
+        response = cx_response_grow(response, &capacity, len + user_len + 1);
+        if (!response) return NULL;
+        memcpy(response + len, user_json, user_len + 1);
+        len += user_len;
     }
     
-    strcat(response, "  ]\n}");
+    response = cx_response_grow(response, &capacity, len + sizeof("  ]\n}"));
+    if (!response) return NULL;
+    strcpy(response + len, "  ]\n}");
     return response;
 }
 
@@ -0,0 +1,56 @@
+/**
+ * @file activation.c
+ * @brief Implementation of socket activation (LISTEN_FDS/LISTEN_PID).
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#include "activation.h"
+#include "listener.h"
+#include "utils.h"
+
+#include <fcntl.h>
+
+
+static int passed[ACTIVATION_MAX_FDS];  // passed sockets not handed out yet, -1 once taken
+static int passed_count = -1;           // -1 until the environment has been read
+
+
+/**
+ * @brief Reads the passed sockets from the environment, once.
+ */
+static void activation_load(void) {
+    if (passed_count != -1) {
+        return;
+    }
+    passed_count = 0;
+
+    const char *pid = getenv("LISTEN_PID");
+    const char *fds = getenv("LISTEN_FDS");
+    if (pid && fds && strtol(pid, NULL, 10) == (long)getpid()) {
+        long count = strtol(fds, NULL, 10);
+        if (count > ACTIVATION_MAX_FDS) {
+            fprintf(stderr, "%ld sockets passed, only the first %d are used.\n", count, ACTIVATION_MAX_FDS);
+            count = ACTIVATION_MAX_FDS;
+        }
+        for (int i = 0; i < count; i++) {
+            passed[passed_count++] = ACTIVATION_FIRST_FD + i;
+            fcntl(ACTIVATION_FIRST_FD + i, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+}
+
+
+/**
+ * @brief Takes the passed listening socket bound to an address.
+ *
+ * @return The socket, or -1 if none was passed for `addr`.
+ */
+int activation_listener(const struct sockaddr *addr, socklen_t len) {
+    activation_load();
+    return listener_take(passed, passed_count, addr, len);
+}
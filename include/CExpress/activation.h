@@ -0,0 +1,37 @@
+/**
+ * @file activation.h
+ * @brief Socket activation: listening sockets opened by a supervisor.
+ *
+ * A supervisor such as systemd can bind the port itself and start the server
+ * with the listening sockets already open, following the LISTEN_FDS
+ * convention: LISTEN_PID names the process they are meant for, LISTEN_FDS how
+ * many there are, numbered from ACTIVATION_FIRST_FD. The supervisor holds the
+ * port across restarts, and connections arriving while the server starts wait
+ * in the socket's backlog instead of being refused.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#pragma once
+
+#include <sys/socket.h>
+
+
+// User defined constants
+#define ACTIVATION_FIRST_FD 3       // first passed descriptor (SD_LISTEN_FDS_START)
+#define ACTIVATION_MAX_FDS 16       // passed descriptors beyond this many are ignored
+
+
+/**
+ * @brief Takes the passed listening socket bound to an address.
+ *
+ * The environment is read on the first call and then cleared, so child
+ * processes do not mistake the sockets for their own. Each socket is handed
+ * out once.
+ *
+ * @param addr The address the server listens on.
+ * @param len  Length of the address.
+ * @return The socket, or -1 if none was passed for `addr`.
+ */
+int activation_listener(const struct sockaddr *addr, socklen_t len);
@@ -0,0 +1,171 @@
+/**
+ * @file alloc.c
+ * @brief Implementation of the pluggable allocator hooks.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-24
+ */
+
+#include "alloc.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * @struct AllocCounters
+ * @brief Lock-free counters behind CxAllocStats.
+ */
+typedef struct {
+    atomic_size_t allocs;
+    atomic_size_t frees;
+    atomic_size_t reallocs;
+    atomic_size_t bytes_live;
+    atomic_size_t bytes_peak;
+} AllocCounters;
+
+
+static void *libc_malloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *libc_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void libc_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+
+static CxAllocator allocator = { libc_malloc, libc_realloc, libc_free, NULL };
+static AllocCounters counters[MEM_SUBSYSTEM_COUNT];
+
+
+/**
+ * @brief Installs the allocator used for all framework-owned memory.
+ */
+void cx_set_allocator(const CxAllocator *hooks) {
+    if (!hooks || !hooks->malloc_fn || !hooks->realloc_fn || !hooks->free_fn) {
+        allocator = (CxAllocator){ libc_malloc, libc_realloc, libc_free, NULL };
+        return;
+    }
+    allocator = *hooks;
+}
+
+
+/**
+ * @brief Adds `delta` live bytes to a subsystem and updates its peak.
+ */
+static void account_grow(mem_subsystem_t sub, size_t delta) {
+    AllocCounters *c = &counters[sub];
+    size_t live = atomic_fetch_add_explicit(&c->bytes_live, delta, memory_order_relaxed) + delta;
+    size_t peak = atomic_load_explicit(&c->bytes_peak, memory_order_relaxed);
+    while (live > peak
+           && !atomic_compare_exchange_weak_explicit(&c->bytes_peak, &peak, live,
+                                                     memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+
+/**
+ * @brief Allocates memory for a subsystem through the installed allocator.
+ */
+void *cx_malloc(mem_subsystem_t sub, size_t size) {
+    void *ptr = allocator.malloc_fn(allocator.ctx, size);
+    if (ptr) {
+        atomic_fetch_add_explicit(&counters[sub].allocs, 1, memory_order_relaxed);
+        account_grow(sub, size);
+    }
+    return ptr;
+}
+
+
+/**
+ * @brief Allocates zeroed memory for a subsystem.
+ */
+void *cx_calloc(mem_subsystem_t sub, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = cx_malloc(sub, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+
+/**
+ * @brief Resizes memory obtained from cx_malloc()/cx_calloc().
+ */
+void *cx_realloc(mem_subsystem_t sub, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) {
+        return cx_malloc(sub, new_size);
+    }
+    void *resized = allocator.realloc_fn(allocator.ctx, ptr, old_size, new_size);
+    if (resized) {
+        atomic_fetch_add_explicit(&counters[sub].reallocs, 1, memory_order_relaxed);
+        if (new_size >= old_size) {
+            account_grow(sub, new_size - old_size);
+        } else {
+            atomic_fetch_sub_explicit(&counters[sub].bytes_live, old_size - new_size, memory_order_relaxed);
+        }
+    }
+    return resized;
+}
+
+
+/**
+ * @brief Releases memory obtained from the cx_* allocation functions.
+ */
+void cx_free(mem_subsystem_t sub, void *ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    allocator.free_fn(allocator.ctx, ptr, size);
+    atomic_fetch_add_explicit(&counters[sub].frees, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counters[sub].bytes_live, size, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Duplicates a string into subsystem memory.
+ */
+char *cx_mem_strdup(mem_subsystem_t sub, const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = cx_malloc(sub, len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+
+/**
+ * @brief Reads the allocation counters of a subsystem.
+ */
+void cx_alloc_stats(mem_subsystem_t sub, CxAllocStats *stats) {
+    AllocCounters *c = &counters[sub];
+    stats->allocs = atomic_load_explicit(&c->allocs, memory_order_relaxed);
+    stats->frees = atomic_load_explicit(&c->frees, memory_order_relaxed);
+    stats->reallocs = atomic_load_explicit(&c->reallocs, memory_order_relaxed);
+    stats->bytes_live = atomic_load_explicit(&c->bytes_live, memory_order_relaxed);
+    stats->bytes_peak = atomic_load_explicit(&c->bytes_peak, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Returns the name of a subsystem (for logging).
+ */
+const char *cx_subsystem_name(mem_subsystem_t sub) {
+    static const char *names[MEM_SUBSYSTEM_COUNT] = { "server", "router", "cache", "compress", "pool" };
+    return (sub < MEM_SUBSYSTEM_COUNT) ? names[sub] : "unknown";
+}
@@ -0,0 +1,145 @@
+/**
+ * @file alloc.h
+ * @brief Pluggable allocator hooks and per-subsystem allocation accounting.
+ *
+ * Every heap allocation the framework owns goes through cx_malloc(),
+ * cx_realloc() and cx_free(), which forward to a user-installable allocator
+ * (libc by default) and count allocations per subsystem. Frees always carry
+ * the allocation size, so sized allocators (and arena-style allocators) can be
+ * plugged in directly.
+ *
+ * Memory whose ownership crosses the public API stays on libc: handler bodies
+ * (allocated by the application and free()d by the framework) and the arrays
+ * returned by split(), extract_lines(), extract_key_value() and
+ * add_http_header() (free()d by the application).
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-24
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+/**
+ * @enum mem_subsystem_t
+ * @brief Framework subsystems allocations are accounted to.
+ */
+typedef enum {
+    MEM_SERVER,               // Server struct and client table
+    MEM_ROUTER,               // route table
+    MEM_CACHE,                // response cache entries and bodies
+    MEM_COMPRESS,             // compressed bodies and zlib state
+    MEM_POOL,                 // allocations too large for the slab pool
+    MEM_SUBSYSTEM_COUNT
+} mem_subsystem_t;
+
+
+/**
+ * @struct CxAllocator
+ * @brief A set of allocation hooks.
+ */
+typedef struct {
+    void *(*malloc_fn)(void *ctx, size_t size);
+    void *(*realloc_fn)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free_fn)(void *ctx, void *ptr, size_t size);
+    void *ctx;                // passed to every hook
+} CxAllocator;
+
+
+/**
+ * @struct CxAllocStats
+ * @brief Allocation counters of one subsystem.
+ */
+typedef struct {
+    size_t allocs;            // successful allocations (reallocs not included)
+    size_t frees;             // frees
+    size_t reallocs;          // successful reallocations
+    size_t bytes_live;        // bytes currently allocated
+    size_t bytes_peak;        // high-water mark of bytes_live
+} CxAllocStats;
+
+
+/**
+ * @brief Installs the allocator used for all framework-owned memory.
+ *
+ * Must be called before any server is initialized, and the allocator must stay
+ * valid until every server has been freed.
+ *
+ * @param allocator The hooks to use, or NULL to restore libc malloc/realloc/free.
+ */
+void cx_set_allocator(const CxAllocator *allocator);
+
+
+/**
+ * @brief Allocates memory for a subsystem through the installed allocator.
+ *
+ * @param sub  The subsystem to account the allocation to.
+ * @param size Number of bytes.
+ * @return The memory, or NULL on failure.
+ */
+void *cx_malloc(mem_subsystem_t sub, size_t size);
+
+
+/**
+ * @brief Allocates zeroed memory for a subsystem.
+ *
+ * @param sub   The subsystem to account the allocation to.
+ * @param count Number of elements.
+ * @param size  Size of each element.
+ * @return The memory, or NULL on failure (including overflow).
+ */
+void *cx_calloc(mem_subsystem_t sub, size_t count, size_t size);
+
+
+/**
+ * @brief Resizes memory obtained from cx_malloc()/cx_calloc().
+ *
+ * @param sub      The subsystem the memory is accounted to.
+ * @param ptr      The memory (NULL behaves like cx_malloc()).
+ * @param old_size Current size of the memory.
+ * @param new_size Requested size.
+ * @return The resized memory, or NULL on failure (`ptr` is then left untouched).
+ */
+void *cx_realloc(mem_subsystem_t sub, void *ptr, size_t old_size, size_t new_size);
+
+
+/**
+ * @brief Releases memory obtained from cx_malloc()/cx_calloc()/cx_realloc().
+ *
+ * @param sub  The subsystem the memory is accounted to.
+ * @param ptr  The memory (NULL is ignored).
+ * @param size The size it was allocated with.
+ */
+void cx_free(mem_subsystem_t sub, void *ptr, size_t size);
+
+
+/**
+ * @brief Duplicates a string into subsystem memory.
+ *
+ * Free the copy with cx_free(sub, copy, strlen(copy) + 1).
+ *
+ * @param sub The subsystem to account the allocation to.
+ * @param str The string.
+ * @return The copy, or NULL on failure.
+ */
+char *cx_mem_strdup(mem_subsystem_t sub, const char *str);
+
+
+/**
+ * @brief Reads the allocation counters of a subsystem.
+ *
+ * @param sub   The subsystem.
+ * @param stats Receives the counters.
+ */
+void cx_alloc_stats(mem_subsystem_t sub, CxAllocStats *stats);
+
+
+/**
+ * @brief Returns the name of a subsystem (for logging).
+ *
+ * @param sub The subsystem.
+ * @return A static string such as "server" or "cache".
+ */
+const char *cx_subsystem_name(mem_subsystem_t sub);
@@ -0,0 +1,207 @@
+/**
+ * @file arena.c
+ * @brief Implementation of the chunked bump allocator.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-16
+ */
+
+#include "arena.h"
+#include "pool.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * @brief Rounds a size up to the alignment of max_align_t.
+ */
+static size_t arena_align(size_t size) {
+    size_t align = sizeof(max_align_t);
+    return (size + align - 1) & ~(align - 1);
+}
+
+
+/**
+ * @brief Allocates memory from an arena, appending a chunk when none has room.
+ *
+ * Requests that do not fit a standard chunk get a dedicated chunk of their own size.
+ *
+ * @return Pointer to the memory, or NULL if a new chunk could not be allocated.
+ */
+void *arena_alloc(Arena *arena, size_t size) {
+    size = arena_align(size ? size : 1);
+
+    // Move through chunks kept from earlier requests before growing.
+    while (arena->current && arena->current->capacity - arena->current->used < size) {
+        arena->current = arena->current->next;
+    }
+
+    if (!arena->current && arena->fixed) {
+        arena->exhausted = 1; // over budget: refuse rather than allocate
+        return NULL;
+    }
+
+    if (!arena->current) {
+        size_t capacity = ARENA_CHUNK_SIZE - sizeof(ArenaChunk);
+        if (size > capacity) {
+            capacity = size;
+        }
+        ArenaChunk *chunk = pool_alloc(sizeof(ArenaChunk) + capacity);
+        if (!chunk) {
+            perror("pool_alloc failed. Arena chunk not allocated.");
+            return NULL;
+        }
+        chunk->next = NULL;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+
+        if (arena->tail) {
+            arena->tail->next = chunk;
+        } else {
+            arena->head = chunk;
+        }
+        arena->tail = chunk;
+        arena->current = chunk;
+    }
+
+    void *ptr = (char *)arena->current->data + arena->current->used;
+    arena->current->used += size;
+    return ptr;
+}
+
+
+/**
+ * @brief Turns caller-provided memory into a fixed arena that never grows.
+ *
+ * @return 1 on success, 0 if `size` is too small.
+ */
+int arena_init_fixed(Arena *arena, void *memory, size_t size) {
+    memset(arena, 0, sizeof(Arena));
+    if (!memory || size <= sizeof(ArenaChunk)) {
+        return 0;
+    }
+    ArenaChunk *chunk = memory;
+    chunk->next = NULL;
+    chunk->capacity = size - sizeof(ArenaChunk);
+    chunk->used = 0;
+
+    arena->head = chunk;
+    arena->current = chunk;
+    arena->tail = chunk;
+    arena->fixed = 1;
+    return 1;
+}
+
+
+/**
+ * @brief Tells how much memory an arena can still hand out without growing.
+ *
+ * @return Free bytes left in a fixed arena, SIZE_MAX for an arena that grows.
+ */
+size_t arena_available(const Arena *arena) {
+    if (!arena->fixed) {
+        return SIZE_MAX;
+    }
+    size_t available = 0;
+    for (const ArenaChunk *chunk = arena->current; chunk; chunk = chunk->next) {
+        available += chunk->capacity - chunk->used;
+    }
+    return available;
+}
+
+
+/**
+ * @brief Copies `len` bytes of a string into an arena and NUL-terminates the copy.
+ *
+ * @return The copy, or NULL on allocation failure.
+ */
+char *arena_strndup(Arena *arena, const char *str, size_t len) {
+    char *copy = arena_alloc(arena, len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+
+/**
+ * @brief Tells whether a pointer was handed out by an arena.
+ *
+ * @return 1 if `ptr` lies inside one of the arena's chunks, 0 otherwise.
+ */
+int arena_owns(const Arena *arena, const void *ptr) {
+    const char *p = ptr;
+    for (const ArenaChunk *chunk = arena->head; chunk; chunk = chunk->next) {
+        const char *start = (const char *)chunk->data;
+        if (p >= start && p < start + chunk->capacity) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Releases every allocation of an arena at once, keeping warm chunks.
+ */
+void arena_reset(Arena *arena) {
+    arena->exhausted = 0;
+    if (arena->fixed) {
+        for (ArenaChunk *chunk = arena->head; chunk; chunk = chunk->next) {
+            chunk->used = 0;
+        }
+        arena->current = arena->head;
+        return;
+    }
+
+    size_t kept = 0;
+    ArenaChunk *prev = NULL;
+    ArenaChunk *chunk = arena->head;
+
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        if (kept + chunk->capacity <= ARENA_RETAIN_BYTES) {
+            kept += chunk->capacity;
+            chunk->used = 0;
+            prev = chunk;
+        } else {
+            // Over the retention budget: unlink and give it back.
+            if (prev) {
+                prev->next = next;
+            } else {
+                arena->head = next;
+            }
+            pool_free(chunk, sizeof(ArenaChunk) + chunk->capacity);
+        }
+        chunk = next;
+    }
+
+    arena->tail = prev;
+    arena->current = arena->head;
+}
+
+
+/**
+ * @brief Frees all chunks of an arena, leaving it empty.
+ */
+void arena_free(Arena *arena) {
+    if (arena->fixed) {
+        memset(arena, 0, sizeof(Arena)); // memory belongs to the caller
+        return;
+    }
+
+    ArenaChunk *chunk = arena->head;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        pool_free(chunk, sizeof(ArenaChunk) + chunk->capacity);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->tail = NULL;
+}
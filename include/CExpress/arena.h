@@ -0,0 +1,127 @@
+/**
+ * @file arena.h
+ * @brief Chunked bump allocator used for per-request memory.
+ *
+ * An Arena hands out memory by bumping a pointer inside large chunks and frees
+ * everything at once with arena_reset(). Chunks come from the slab pool and are
+ * kept across resets, so once an arena has warmed up a typical request performs
+ * no allocation at all.
+ *
+ * A fixed arena (see arena_init_fixed()) never grows: it serves requests from
+ * caller-provided memory only and reports exhaustion instead of allocating.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-16
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+// User defined constants
+#define ARENA_CHUNK_SIZE 8192             // default chunk size in bytes (header included)
+#define ARENA_RETAIN_BYTES (1024 * 1024)  // chunk capacity kept across arena_reset()
+
+
+/**
+ * @struct ArenaChunk
+ * @brief A contiguous block of arena memory.
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;  // next chunk in the arena
+    size_t capacity;          // usable bytes in `data`
+    size_t used;              // bytes handed out from `data`
+    max_align_t data[];       // chunk memory (max_align_t keeps allocations aligned)
+} ArenaChunk;
+
+
+/**
+ * @struct Arena
+ * @brief A list of chunks with a bump pointer in the current one.
+ *
+ * A zeroed Arena is a valid, empty arena.
+ */
+typedef struct {
+    ArenaChunk *head;         // first chunk
+    ArenaChunk *current;      // chunk allocations are served from
+    ArenaChunk *tail;         // last chunk (new chunks are appended here)
+    int fixed;                // 1 if the arena must not allocate chunks of its own
+    int exhausted;            // 1 once a fixed arena refused an allocation (cleared by reset)
+} Arena;
+
+
+/**
+ * @brief Turns caller-provided memory into a fixed arena that never grows.
+ *
+ * @param arena  The arena to initialize.
+ * @param memory Backing memory, aligned for any type. Must outlive the arena.
+ * @param size   Size of `memory` in bytes (must exceed sizeof(ArenaChunk)).
+ * @return 1 on success, 0 if `size` is too small.
+ */
+int arena_init_fixed(Arena *arena, void *memory, size_t size);
+
+
+/**
+ * @brief Allocates memory from an arena.
+ *
+ * The memory is aligned for any type and stays valid until the next
+ * arena_reset() or arena_free().
+ *
+ * @param arena The arena.
+ * @param size  Number of bytes to allocate.
+ * @return Pointer to the memory, or NULL if a new chunk could not be allocated.
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+
+/**
+ * @brief Tells how much memory an arena can still hand out without growing.
+ *
+ * @param arena The arena.
+ * @return Free bytes left in the current and later chunks of a fixed arena,
+ *         SIZE_MAX for an arena that grows.
+ */
+size_t arena_available(const Arena *arena);
+
+
+/**
+ * @brief Copies `len` bytes of a string into an arena and NUL-terminates the copy.
+ *
+ * @param arena The arena.
+ * @param str   Source characters.
+ * @param len   Number of characters to copy.
+ * @return The copy, or NULL on allocation failure.
+ */
+char *arena_strndup(Arena *arena, const char *str, size_t len);
+
+
+/**
+ * @brief Tells whether a pointer was handed out by an arena.
+ *
+ * @param arena The arena.
+ * @param ptr   The pointer to check.
+ * @return 1 if `ptr` lies inside one of the arena's chunks, 0 otherwise.
+ */
+int arena_owns(const Arena *arena, const void *ptr);
+
+
+/**
+ * @brief Releases every allocation of an arena at once.
+ *
+ * Chunks up to ARENA_RETAIN_BYTES of capacity are kept for reuse; the rest
+ * are returned to the system. Fixed arenas keep their memory.
+ *
+ * @param arena The arena.
+ */
+void arena_reset(Arena *arena);
+
+
+/**
+ * @brief Frees all chunks of an arena, leaving it empty.
+ *
+ * The memory of a fixed arena belongs to the caller and is not freed.
+ *
+ * @param arena The arena.
+ */
+void arena_free(Arena *arena);
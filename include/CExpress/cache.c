@@ -0,0 +1,310 @@
+/**
+ * @file cache.c
+ * @brief Implementation of the in-memory response cache.
+ *
+ * Entries are kept in a flat array and searched linearly, like RouterList: the
+ * number of cacheable routes is small and bounded by the number of routes.
+ *
+ * Large bodies live in memfds sealed against any modification, which makes it
+ * safe to hand them to sendfile() while they stay shared by every hit.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-14
+ */
+
+#define _GNU_SOURCE // memfd_create(), F_ADD_SEALS
+
+#include "cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+
+/**
+ * @brief Initializes an empty response cache.
+ *
+ * @return 1 on success, 0 on allocation failure.
+ */
+int cache_init(ResponseCache *cache, size_t max_bytes) {
+    cache->count = 0;
+    cache->capacity = 4;
+    cache->bytes = 0;
+    cache->max_bytes = max_bytes;
+    cache->limit = max_bytes;
+    cache->memfd_threshold = CACHE_DEFAULT_MEMFD_THRESHOLD;
+    cache->items = cx_calloc(MEM_CACHE, cache->capacity, sizeof(CacheEntry));
+    if (!cache->items) {
+        perror("cx_calloc failed. Response cache not initialized.");
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Tells whether a cached body is present (in memory or in a memfd).
+ */
+int cached_body_present(const CachedBody *body) {
+    return body->data != NULL || body->fd >= 0;
+}
+
+
+/**
+ * @brief Moves a body into a sealed memfd if it reaches the cache's threshold.
+ *
+ * On success the heap copy is freed and `body->fd` takes over. On any failure
+ * (or on platforms without memfd) the body simply stays in memory.
+ */
+static void cached_body_to_memfd(const ResponseCache *cache, CachedBody *body, mem_subsystem_t sub) {
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+    if (cache->memfd_threshold == 0 || body->len < cache->memfd_threshold) {
+        return;
+    }
+
+    int fd = memfd_create("cexpress-cache", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        perror("memfd_create failed. Body kept in memory.");
+        return;
+    }
+    if (write_all(fd, body->data, body->len) < 0
+        || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        perror("memfd setup failed. Body kept in memory.");
+        close(fd);
+        return;
+    }
+
+    cx_free(sub, body->data, body->alloc_size);
+    body->data = NULL;
+    body->alloc_size = 0;
+    body->fd = fd;
+#else
+    (void)cache;
+    (void)body;
+    (void)sub;
+#endif
+}
+
+
+/**
+ * @brief Releases the storage of a body (heap buffer or memfd).
+ */
+static void cached_body_release(CachedBody *body, mem_subsystem_t sub) {
+    cx_free(sub, body->data, body->alloc_size);
+    if (body->fd >= 0) {
+        close(body->fd);
+    }
+    body->data = NULL;
+    body->fd = -1;
+    body->len = 0;
+    body->alloc_size = 0;
+}
+
+
+/**
+ * @brief Sends a cached body to a socket, using sendfile() for memfd-backed bodies.
+ *
+ * @return 1 if the whole body was sent or is under way, 0 on error.
+ */
+int cached_body_send(Output *out, int sock, const CachedBody *body) {
+    if (body->fd < 0) {
+        return output_write(out, sock, body->data, body->len) >= 0;
+    }
+    return output_send_file(out, sock, body->fd, body->len) >= 0;
+}
+
+
+/**
+ * @brief Releases all variants of an entry and removes it from the cache.
+ *
+ * The last entry is moved into the freed slot, so indices are not stable.
+ */
+static void cache_remove_at(ResponseCache *cache, size_t index) {
+    CacheEntry *entry = &cache->items[index];
+    for (int i = 0; i < ENC_COUNT; i++) {
+        cache->bytes -= entry->variants[i].len;
+        cached_body_release(&entry->variants[i], i == ENC_IDENTITY ? MEM_CACHE : MEM_COMPRESS);
+    }
+    cx_free(MEM_CACHE, entry->path, strlen(entry->path) + 1);
+
+    cache->count--;
+    cache->items[index] = cache->items[cache->count];
+    memset(&cache->items[cache->count], 0, sizeof(CacheEntry));
+}
+
+
+/**
+ * @brief Frees every entry and the storage of a response cache.
+ */
+void cache_free(ResponseCache *cache) {
+    if (!cache->items) return;
+
+    while (cache->count > 0) {
+        cache_remove_at(cache, cache->count - 1);
+    }
+    cx_free(MEM_CACHE, cache->items, cache->capacity * sizeof(CacheEntry));
+    cache->items = NULL;
+    cache->capacity = 0;
+}
+
+
+/**
+ * @brief Finds a live entry for a route, dropping expired entries on the way.
+ *
+ * @return The entry, or NULL if there is no live entry.
+ */
+CacheEntry *cache_lookup(ResponseCache *cache, int method, const char *path, long long now) {
+    for (size_t i = 0; i < cache->count; i++) {
+        CacheEntry *entry = &cache->items[i];
+        if (entry->expires_ms <= now) {
+            cache_remove_at(cache, i);
+            i--; // re-check the entry moved into this slot
+            continue;
+        }
+        if (entry->method == method && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Evicts entries (soonest expiry first) until `needed` more bytes fit.
+ *
+ * @return 1 if the bytes fit after eviction, 0 if they exceed the bound on their own.
+ */
+static int cache_make_room(ResponseCache *cache, size_t needed) {
+    if (needed > cache->limit) {
+        return 0;
+    }
+    while (cache->count > 0 && cache->bytes + needed > cache->limit) {
+        size_t victim = 0;
+        for (size_t i = 1; i < cache->count; i++) {
+            if (cache->items[i].expires_ms < cache->items[victim].expires_ms) {
+                victim = i;
+            }
+        }
+        cache_remove_at(cache, victim);
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Changes the byte bound in effect, evicting entries to get under it.
+ *
+ * @return The number of bytes released.
+ */
+size_t cache_set_limit(ResponseCache *cache, size_t limit) {
+    size_t before = cache->bytes;
+    cache->limit = (limit < cache->max_bytes) ? limit : cache->max_bytes;
+    if (cache->limit == 0) {
+        while (cache->count > 0) {
+            cache_remove_at(cache, cache->count - 1);
+        }
+    } else {
+        cache_make_room(cache, 0);
+    }
+    return before - cache->bytes;
+}
+
+
+/**
+ * @brief Stores a copy of a handler's identity body for a route.
+ *
+ * @return The new entry, or NULL if it could not be stored.
+ */
+CacheEntry *cache_store(ResponseCache *cache, int method, const char *path,
+                        const char *body, size_t len, long long expires_ms, int level) {
+    if (cache->limit == 0 || !cache_make_room(cache, len)) {
+        return NULL;
+    }
+
+    if (cache->count == cache->capacity) {
+        size_t new_cap = cache->capacity * 2;
+        CacheEntry *temp = cx_realloc(MEM_CACHE, cache->items, cache->capacity * sizeof(CacheEntry),
+                                      new_cap * sizeof(CacheEntry));
+        if (!temp) {
+            perror("cx_realloc failed. Response not cached.");
+            return NULL;
+        }
+        cache->items = temp;
+        cache->capacity = new_cap;
+    }
+
+    char *path_copy = cx_mem_strdup(MEM_CACHE, path);
+    char *body_copy = cx_malloc(MEM_CACHE, len + 1);
+    if (!path_copy || !body_copy) {
+        perror("cx_malloc failed. Response not cached.");
+        if (path_copy) cx_free(MEM_CACHE, path_copy, strlen(path_copy) + 1);
+        if (body_copy) cx_free(MEM_CACHE, body_copy, len + 1);
+        return NULL;
+    }
+    memcpy(body_copy, body, len);
+    body_copy[len] = '\0';
+
+    CacheEntry *entry = &cache->items[cache->count++];
+    memset(entry, 0, sizeof(CacheEntry));
+    entry->method = method;
+    entry->path = path_copy;
+    entry->expires_ms = expires_ms;
+    entry->level = level;
+    for (int i = 0; i < ENC_COUNT; i++) {
+        entry->variants[i].fd = -1;
+    }
+    entry->variants[ENC_IDENTITY].data = body_copy;
+    entry->variants[ENC_IDENTITY].len = len;
+    entry->variants[ENC_IDENTITY].alloc_size = len + 1;
+    cached_body_to_memfd(cache, &entry->variants[ENC_IDENTITY], MEM_CACHE);
+    cache->bytes += len;
+    return entry;
+}
+
+
+/**
+ * @brief Returns the representation of an entry for a negotiated encoding,
+ *        compressing and storing it on first use.
+ */
+const CachedBody *cache_variant(ResponseCache *cache, CacheEntry *entry, encoding_t *enc) {
+    CachedBody *identity = &entry->variants[ENC_IDENTITY];
+    if (*enc == ENC_IDENTITY || *enc >= ENC_COUNT) {
+        *enc = ENC_IDENTITY;
+        return identity;
+    }
+
+    CachedBody *variant = &entry->variants[*enc];
+    if (variant->skip) {
+        *enc = ENC_IDENTITY;
+        return identity;
+    }
+    if (!cached_body_present(variant)) {
+        // A memfd-backed identity body is mapped read-only just for compression.
+        const char *src = identity->data;
+        if (!src) {
+            src = mmap(NULL, identity->len, PROT_READ, MAP_SHARED, identity->fd, 0);
+            if (src == MAP_FAILED) {
+                perror("mmap failed. Response not compressed.");
+                *enc = ENC_IDENTITY;
+                return identity;
+            }
+        }
+        size_t out_len = 0;
+        char *out = compress_buffer(src, identity->len, *enc, entry->level, &out_len);
+        if (src != identity->data) {
+            munmap((void *)src, identity->len);
+        }
+        if (!out || out_len >= identity->len || cache->bytes + out_len > cache->limit) {
+            // Not worth it (or no room): remember the outcome so hits never retry.
+            cx_free(MEM_COMPRESS, out, out_len);
+            variant->skip = 1;
+            *enc = ENC_IDENTITY;
+            return identity;
+        }
+        variant->data = out;
+        variant->len = out_len;
+        variant->alloc_size = out_len;
+        cached_body_to_memfd(cache, variant, MEM_COMPRESS);
+        cache->bytes += out_len;
+    }
+    return variant;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file cache.h
+ * @brief In-memory response cache for the CExpress framework.
+ *
+ * Routes opt into caching with a time-to-live. A cache entry holds the handler's
+ * identity body together with lazily computed compressed variants, so repeated
+ * hits neither re-run the handler nor recompress the body.
+ *
+ * Entries and identity bodies are accounted to MEM_CACHE; compressed variants,
+ * produced by compress_buffer(), stay accounted to MEM_COMPRESS.
+ *
+ * On Linux, bodies at or above a size threshold are moved into a sealed memfd
+ * and served with sendfile(), so large responses are never copied through
+ * user space on a hit.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-14
+ */
+
+#pragma once
+
+#include "utils.h"
+#include "compress.h"
+#include "alloc.h"
+
+
+// User defined constants
+#define CACHE_DEFAULT_MAX_BYTES (16 * 1024 * 1024) // total bytes of bodies kept by a ResponseCache
+#define CACHE_DEFAULT_MEMFD_THRESHOLD (1024 * 1024) // bodies this large are stored in a sealed memfd
+
+
+/**
+ * @struct CachedBody
+ * @brief One representation (identity or compressed) of a cached response body.
+ */
+typedef struct {
+    char *data;               // body bytes, NULL if not computed yet or stored in `fd`
+    int fd;                   // sealed memfd holding the body, -1 if the body is in `data`
+    size_t len;               // body length in bytes
+    size_t alloc_size;        // size of the allocation behind `data`
+    int skip;                 // 1 if compressing was tried and did not pay off
+} CachedBody;
+
+
+/**
+ * @struct CacheEntry
+ * @brief A cached response for a single route.
+ */
+typedef struct {
+    int method;                        // method_t of the cached route
+    char *path;                        // owned copy of the route path
+    long long expires_ms;              // monotonic expiry time (see now_ms())
+    int level;                         // compression level used for the variants
+    CachedBody variants[ENC_COUNT];    // indexed by encoding_t
+} CacheEntry;
+
+
+/**
+ * @struct ResponseCache
+ * @brief A bounded collection of CacheEntry objects.
+ */
+typedef struct {
+    CacheEntry *items;
+    size_t count;
+    size_t capacity;
+    size_t bytes;             // sum of all stored variant lengths
+    size_t max_bytes;         // configured bound on `bytes`
+    size_t limit;             // bound in effect (max_bytes, lowered under memory pressure); entries are evicted to stay under it
+    size_t memfd_threshold;   // bodies at least this large go to a memfd, 0 disables
+} ResponseCache;
+
+
+/**
+ * @brief Initializes an empty response cache.
+ *
+ * @param cache     The cache to initialize.
+ * @param max_bytes Upper bound on the total size of stored bodies.
+ * @return 1 on success, 0 on allocation failure.
+ */
+int cache_init(ResponseCache *cache, size_t max_bytes);
+
+
+/**
+ * @brief Changes the byte bound in effect, evicting entries to get under it.
+ *
+ * Used to shrink the cache under memory pressure and to grow it back (up to
+ * `max_bytes`) when the pressure subsides.
+ *
+ * @param cache The cache.
+ * @param limit New bound; values above `max_bytes` are clamped to it.
+ * @return The number of bytes released.
+ */
+size_t cache_set_limit(ResponseCache *cache, size_t limit);
+
+
+/**
+ * @brief Tells whether a cached body is present (in memory or in a memfd).
+ *
+ * @param body The body representation.
+ * @return 1 if the body is stored, 0 otherwise.
+ */
+int cached_body_present(const CachedBody *body);
+
+
+/**
+ * @brief Sends a cached body to a socket.
+ *
+ * In-memory bodies are written directly; memfd-backed bodies are sent with
+ * sendfile() without copying through user space. When the socket is full, the
+ * connection's output keeps a duplicate of the memfd and an offset and resumes
+ * with sendfile() once the client catches up, so an eviction in between is harmless.
+ *
+ * @param out  The connection's output (see output_write()), or NULL.
+ * @param sock The destination socket.
+ * @param body The body representation.
+ * @return 1 if the whole body was sent or is under way, 0 on error.
+ */
+int cached_body_send(Output *out, int sock, const CachedBody *body);
+
+
+/**
+ * @brief Frees every entry and the storage of a response cache.
+ *
+ * @param cache The cache to free.
+ */
+void cache_free(ResponseCache *cache);
+
+
+/**
+ * @brief Finds a live (unexpired) entry for a route.
+ *
+ * Expired entries encountered during the lookup are released.
+ *
+ * @param cache  The cache.
+ * @param method The route's method.
+ * @param path   The route's path.
+ * @param now    Current monotonic time in milliseconds.
+ * @return The entry, or NULL if there is no live entry.
+ */
+CacheEntry *cache_lookup(ResponseCache *cache, int method, const char *path, long long now);
+
+
+/**
+ * @brief Stores a handler's identity body for a route.
+ *
+ * The body is copied into cache memory (or, at or above the memfd threshold, into
+ * a sealed memfd); the caller keeps ownership of `body`. Older entries are evicted
+ * (soonest expiry first) to respect the cache's byte bound in effect.
+ *
+ * @param cache      The cache.
+ * @param method     The route's method.
+ * @param path       The route's path.
+ * @param body       Identity body.
+ * @param len        Length of `body`.
+ * @param expires_ms Monotonic expiry time of the entry.
+ * @param level      Compression level used when computing compressed variants.
+ * @return The new entry, or NULL if it could not be stored.
+ */
+CacheEntry *cache_store(ResponseCache *cache, int method, const char *path,
+                        const char *body, size_t len, long long expires_ms, int level);
+
+
+/**
+ * @brief Returns the representation of an entry to send for a negotiated encoding.
+ *
+ * The compressed variant is computed on first use and stored in the entry. If
+ * compression fails or does not make the body smaller, the identity variant is
+ * returned and `*enc` is reset to ENC_IDENTITY.
+ *
+ * @param cache The cache owning the entry (for byte accounting).
+ * @param entry The entry.
+ * @param enc   In: the negotiated encoding. Out: the encoding actually returned.
+ * @return The body representation to send.
+ */
+const CachedBody *cache_variant(ResponseCache *cache, CacheEntry *entry, encoding_t *enc);
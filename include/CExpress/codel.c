@@ -0,0 +1,46 @@
+/**
+ * @file codel.c
+ * @brief Implementation of CoDel-style overload detection.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-29
+ */
+
+#include "codel.h"
+
+
+/**
+ * @brief Initializes the overload state.
+ */
+void codel_init(CoDel *codel, long long target_us, long long interval_us) {
+    codel->target_us = target_us;
+    codel->interval_us = interval_us;
+    codel->interval_end_us = 0;
+    codel->min_delay_us = -1;
+    codel->overloaded = 0;
+    codel->dropped = 0;
+}
+
+
+/**
+ * @brief Records the sojourn time of a dequeued request and decides whether to shed it.
+ *
+ * @return 1 if the request should be shed, 0 if it should be served.
+ */
+int codel_should_drop(CoDel *codel, long long delay_us, long long now_us) {
+    if (now_us >= codel->interval_end_us) {
+        // Interval over: overloaded if no request got through quickly during it.
+        codel->overloaded = codel->min_delay_us > codel->target_us;
+        codel->interval_end_us = now_us + codel->interval_us;
+        codel->min_delay_us = delay_us;
+    } else if (codel->min_delay_us < 0 || delay_us < codel->min_delay_us) {
+        codel->min_delay_us = delay_us;
+    }
+
+    long long timeout_us = codel->overloaded ? 2 * codel->target_us : codel->interval_us;
+    if (delay_us > timeout_us) {
+        codel->dropped++;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file codel.h
+ * @brief CoDel-style overload detection for the pending-request queue.
+ *
+ * The server measures how long each request waited in its queue (its sojourn
+ * time). If even the shortest wait over a whole interval stayed above the
+ * target, the queue never drained: the server is overloaded. While overloaded,
+ * requests that waited more than twice the target are shed (their clients
+ * have most likely given up), and the queue is served newest first so fresh
+ * requests still meet their deadlines. Otherwise requests are only shed after
+ * waiting a full interval, and the queue is served in arrival order.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-29
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+// User defined constants
+#define CODEL_DEFAULT_TARGET_US 5000       // acceptable standing queue delay
+#define CODEL_DEFAULT_INTERVAL_US 100000   // window over which the minimum delay is tracked
+
+
+/**
+ * @struct CoDel
+ * @brief Overload state of a request queue.
+ */
+typedef struct {
+    long long target_us;       // acceptable standing queue delay, 0 when shedding is disabled
+    long long interval_us;     // observation interval
+    long long interval_end_us; // end of the current observation interval
+    long long min_delay_us;    // shortest sojourn time seen in the current interval, -1 if none
+    int overloaded;            // 1 if the previous interval never saw a delay below the target
+    size_t dropped;            // requests shed
+} CoDel;
+
+
+/**
+ * @brief Initializes the overload state.
+ *
+ * @param codel       The state to initialize.
+ * @param target_us   Acceptable standing queue delay in microseconds.
+ * @param interval_us Observation interval in microseconds.
+ */
+void codel_init(CoDel *codel, long long target_us, long long interval_us);
+
+
+/**
+ * @brief Records the sojourn time of a dequeued request and decides whether to shed it.
+ *
+ * @param codel    The overload state.
+ * @param delay_us How long the request waited in the queue, in microseconds.
+ * @param now_us   Current monotonic time in microseconds.
+ * @return 1 if the request should be shed, 0 if it should be served.
+ */
+int codel_should_drop(CoDel *codel, long long delay_us, long long now_us);
@@ -0,0 +1,303 @@
+/**
+ * @file compress.c
+ * @brief Implementation of response compression for the CExpress framework.
+ *
+ * Wraps zlib to negotiate, compress and stream gzip/deflate response bodies.
+ * "deflate" follows HTTP semantics, i.e. the zlib format (RFC 1950).
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-14
+ */
+
+#include "compress.h"
+#include "pool.h"
+
+#include <stdatomic.h>
+
+
+/**
+ * @brief Returns the zlib windowBits value selecting the container for an encoding.
+ */
+static int window_bits(encoding_t enc) {
+    return (enc == ENC_GZIP) ? 15 + 16 : 15; // +16 asks zlib for a gzip wrapper
+}
+
+
+/**
+ * @brief zlib allocation callback routing zlib's state through the allocator hooks.
+ *
+ * zlib frees without a size, so the size is stored in a header in front of the block.
+ */
+static voidpf hook_zalloc(voidpf opaque, uInt items, uInt size) {
+    (void)opaque;
+    size_t bytes = (size_t)items * size + sizeof(max_align_t);
+    max_align_t *block = cx_malloc(MEM_COMPRESS, bytes);
+    if (!block) {
+        return Z_NULL;
+    }
+    *(size_t *)block = bytes;
+    return block + 1;
+}
+
+
+/**
+ * @brief zlib release callback matching hook_zalloc().
+ */
+static void hook_zfree(voidpf opaque, voidpf address) {
+    (void)opaque;
+    max_align_t *block = (max_align_t *)address - 1;
+    cx_free(MEM_COMPRESS, block, *(size_t *)block);
+}
+
+
+/**
+ * @brief Picks the best content coding accepted by a client.
+ *
+ * Parses a comma separated list of codings with optional q-values. Codings
+ * with q=0 are refused. gzip is preferred over deflate. "*" only stands for
+ * the codings the list does not name (RFC 9110), so "gzip;q=0, *" still refuses gzip.
+ *
+ * @param accept_encoding The value of the request's Accept-Encoding header, or NULL.
+ * @return ENC_GZIP or ENC_DEFLATE if acceptable, ENC_IDENTITY otherwise.
+ */
+encoding_t negotiate_encoding(const char *accept_encoding) {
+    if (!accept_encoding) {
+        return ENC_IDENTITY;
+    }
+
+    double gzip_q = -1, deflate_q = -1, any_q = -1; // -1 while the coding is not listed
+    const char *p = accept_encoding;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *token = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') p++;
+        size_t token_len = p - token;
+
+        // Parse parameters up to the next coding; only q matters.
+        double q = 1.0;
+        while (*p && *p != ',') {
+            if (*p == ';') {
+                p++;
+                while (*p == ' ') p++;
+                if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+                    q = strtod(p + 2, NULL);
+                }
+            } else {
+                p++;
+            }
+        }
+
+        if (token_len == 4 && strncasecmp(token, "gzip", 4) == 0) {
+            gzip_q = q;
+        } else if (token_len == 7 && strncasecmp(token, "deflate", 7) == 0) {
+            deflate_q = q;
+        } else if (token_len == 1 && token[0] == '*') {
+            any_q = q;
+        }
+    }
+    if (gzip_q < 0) gzip_q = any_q;
+    if (deflate_q < 0) deflate_q = any_q;
+
+    if (gzip_q > 0) return ENC_GZIP;
+    if (deflate_q > 0) return ENC_DEFLATE;
+    return ENC_IDENTITY;
+}
+
+
+/**
+ * @brief Returns the Content-Encoding token for an encoding.
+ */
+const char *encoding_name(encoding_t enc) {
+    switch (enc) {
+        case ENC_GZIP:    return "gzip";
+        case ENC_DEFLATE: return "deflate";
+        default:          return "identity";
+    }
+}
+
+
+/**
+ * @brief Compresses a complete buffer in one call.
+ *
+ * The output buffer is sized with deflateBound(), so a single deflate() call
+ * always completes; it is then shrunk to the compressed length.
+ *
+ * @param data    The input data.
+ * @param len     Length of the input data.
+ * @param enc     ENC_GZIP or ENC_DEFLATE.
+ * @param level   zlib compression level (1-9).
+ * @param out_len Receives the length of the compressed data.
+ *
+ * @return A buffer of `*out_len` bytes, or NULL on failure. Release it with cx_free(MEM_COMPRESS, ...).
+ */
+char *compress_buffer(const char *data, size_t len, encoding_t enc, int level, size_t *out_len) {
+    if (enc == ENC_IDENTITY || !out_len) {
+        return NULL;
+    }
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = hook_zalloc;
+    zs.zfree = hook_zfree;
+    if (deflateInit2(&zs, level, Z_DEFLATED, window_bits(enc), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "deflateInit2 failed. Response not compressed.\n");
+        return NULL;
+    }
+
+    size_t bound = deflateBound(&zs, len);
+    char *out = cx_malloc(MEM_COMPRESS, bound);
+    if (!out) {
+        perror("cx_malloc failed. Response not compressed.");
+        deflateEnd(&zs);
+        return NULL;
+    }
+
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = len;
+    zs.next_out = (Bytef *)out;
+    zs.avail_out = bound;
+
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        fprintf(stderr, "deflate failed. Response not compressed.\n");
+        cx_free(MEM_COMPRESS, out, bound);
+        deflateEnd(&zs);
+        return NULL;
+    }
+
+    *out_len = zs.total_out;
+    deflateEnd(&zs);
+
+    char *shrunk = cx_realloc(MEM_COMPRESS, out, bound, *out_len ? *out_len : 1);
+    if (!shrunk) {
+        cx_free(MEM_COMPRESS, out, bound);
+        return NULL;
+    }
+    return shrunk;
+}
+
+
+/**
+ * @brief Sends one HTTP/1.1 chunk (size line, data, CRLF).
+ */
+static int send_chunk(CompressStream *stream, const char *data, size_t len) {
+    char size_line[32];
+    int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    return output_write(stream->output, stream->sock, size_line, n) >= 0
+        && output_write(stream->output, stream->sock, data, len) >= 0
+        && output_write(stream->output, stream->sock, "\r\n", 2) >= 0;
+}
+
+
+/**
+ * @brief zlib allocation callback serving memory from an Arena.
+ */
+static voidpf arena_zalloc(voidpf opaque, uInt items, uInt size) {
+    return arena_alloc((Arena *)opaque, (size_t)items * size);
+}
+
+
+/**
+ * @brief zlib release callback for arena memory (released with the arena).
+ */
+static void arena_zfree(voidpf opaque, voidpf address) {
+    (void)opaque;
+    (void)address;
+}
+
+
+/**
+ * @brief Starts a streaming compressor writing chunked output to a socket.
+ *
+ * With an arena, zlib's window and hash tables (a few hundred KB) are carved
+ * from it, so warm arenas stream without touching malloc().
+ *
+ * @return 1 on success, 0 on failure.
+ */
+int compress_stream_init(CompressStream *stream, Output *output, int sock, encoding_t enc, int level, Arena *arena) {
+    memset(stream, 0, sizeof(*stream));
+    if (enc == ENC_IDENTITY) {
+        return 0;
+    }
+    if (arena) {
+        stream->zs.zalloc = arena_zalloc;
+        stream->zs.zfree = arena_zfree;
+        stream->zs.opaque = arena;
+    } else {
+        stream->zs.zalloc = hook_zalloc;
+        stream->zs.zfree = hook_zfree;
+    }
+    if (arena && arena_available(arena) < COMPRESS_STREAM_MEMORY + COMPRESS_CHUNK_SIZE) {
+        // A fixed arena too small for zlib would fail every request: send identity without trying.
+        static atomic_int warned = 0;
+        if (!atomic_exchange(&warned, 1)) {
+            fprintf(stderr, "Arena too small for a compression stream (%d bytes needed). Responses sent uncompressed.\n",
+                    COMPRESS_STREAM_MEMORY + COMPRESS_CHUNK_SIZE);
+        }
+        return 0;
+    }
+    stream->out_pooled = (arena == NULL);
+    stream->out = arena ? arena_alloc(arena, COMPRESS_CHUNK_SIZE) : pool_alloc(COMPRESS_CHUNK_SIZE);
+    if (!stream->out) {
+        return 0;
+    }
+    if (deflateInit2(&stream->zs, level, Z_DEFLATED, window_bits(enc), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "deflateInit2 failed. Stream not started.\n");
+        if (stream->out_pooled) pool_free(stream->out, COMPRESS_CHUNK_SIZE);
+        stream->out = NULL;
+        return 0;
+    }
+    stream->sock = sock;
+    stream->output = output;
+    stream->active = 1;
+    return 1;
+}
+
+
+/**
+ * @brief Feeds data into a streaming compressor, emitting full chunks as they fill.
+ *
+ * @return 1 on success, 0 on a compression or socket error.
+ */
+int compress_stream_write(CompressStream *stream, const char *data, size_t len, int finish) {
+    if (!stream->active) {
+        return 0;
+    }
+
+    char *out = stream->out;
+    int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+    int status;
+
+    stream->zs.next_in = (Bytef *)data;
+    stream->zs.avail_in = len;
+    do {
+        stream->zs.next_out = (Bytef *)out;
+        stream->zs.avail_out = COMPRESS_CHUNK_SIZE;
+        status = deflate(&stream->zs, flush);
+        if (status == Z_STREAM_ERROR) {
+            fprintf(stderr, "deflate failed. Stream aborted.\n");
+            return 0;
+        }
+        size_t produced = COMPRESS_CHUNK_SIZE - stream->zs.avail_out;
+        if (produced > 0 && !send_chunk(stream, out, produced)) {
+            return 0;
+        }
+    } while (stream->zs.avail_out == 0 || (finish && status != Z_STREAM_END));
+
+    if (finish) {
+        return output_write(stream->output, stream->sock, "0\r\n\r\n", 5) >= 0; // last-chunk + empty trailer
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Releases the resources held by a streaming compressor.
+ */
+void compress_stream_end(CompressStream *stream) {
+    if (stream->active) {
+        deflateEnd(&stream->zs);
+        if (stream->out_pooled) pool_free(stream->out, COMPRESS_CHUNK_SIZE);
+        stream->out = NULL;
+        stream->active = 0;
+    }
+}
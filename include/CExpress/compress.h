@@ -0,0 +1,122 @@
+/**
+ * @file compress.h
+ * @brief Response compression (gzip/deflate) for the CExpress framework.
+ *
+ * Provides Accept-Encoding negotiation, one-shot compression of complete bodies
+ * (used for cached responses) and a streaming compressor that emits HTTP/1.1
+ * chunked frames directly to a client socket (used for uncached responses).
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-14
+ */
+
+#pragma once
+
+#include <zlib.h>
+
+#include "utils.h"
+#include "arena.h"
+#include "alloc.h"
+#include "output.h"
+
+
+// User defined constants
+#define COMPRESS_DEFAULT_LEVEL 6        // zlib level used when a route does not override it
+#define COMPRESS_DEFAULT_MIN_SIZE 1024  // bodies smaller than this are always sent identity
+#define COMPRESS_CHUNK_SIZE 16384       // size of each chunk emitted by a CompressStream
+#define COMPRESS_STREAM_MEMORY ((1 << 17) + (1 << 17) + 16384) // zlib deflate state (windowBits 15, memLevel 8) with slack
+
+
+/**
+ * @enum encoding_t
+ * @brief Content codings understood by the framework, in order of preference.
+ */
+typedef enum { ENC_IDENTITY, ENC_GZIP, ENC_DEFLATE, ENC_COUNT } encoding_t;
+
+
+/**
+ * @struct CompressStream
+ * @brief Incremental compressor writing a chunked HTTP body to a socket.
+ */
+typedef struct {
+    z_stream zs;              // zlib state
+    int sock;                 // destination socket
+    Output *output;           // connection output the chunks go through (NULL: blocking writes)
+    char *out;                // COMPRESS_CHUNK_SIZE bytes for compressed output
+    int out_pooled;           // 1 if `out` came from the pool (0: from the arena)
+    int active;               // 1 between compress_stream_init() and compress_stream_end()
+} CompressStream;
+
+
+/**
+ * @brief Picks the best content coding accepted by a client.
+ *
+ * @param accept_encoding The value of the request's Accept-Encoding header, or NULL.
+ * @return ENC_GZIP or ENC_DEFLATE if acceptable (q > 0), ENC_IDENTITY otherwise.
+ */
+encoding_t negotiate_encoding(const char *accept_encoding);
+
+
+/**
+ * @brief Returns the Content-Encoding token for an encoding.
+ *
+ * @param enc The encoding.
+ * @return "gzip", "deflate" or "identity".
+ */
+const char *encoding_name(encoding_t enc);
+
+
+/**
+ * @brief Compresses a complete buffer.
+ *
+ * @param data    The input data.
+ * @param len     Length of the input data.
+ * @param enc     ENC_GZIP or ENC_DEFLATE.
+ * @param level   zlib compression level (1-9).
+ * @param out_len Receives the length of the compressed data.
+ *
+ * @return A buffer of exactly `*out_len` bytes holding the compressed data, or NULL on failure.
+ *         The caller must release it with cx_free(MEM_COMPRESS, buffer, *out_len).
+ */
+char *compress_buffer(const char *data, size_t len, encoding_t enc, int level, size_t *out_len);
+
+
+/**
+ * @brief Starts a streaming compressor writing chunked output to a socket.
+ *
+ * @param stream The stream to initialize.
+ * @param output The connection's output (see output_write()), or NULL.
+ * @param sock   The client socket the chunks are written to.
+ * @param enc    ENC_GZIP or ENC_DEFLATE.
+ * @param level  zlib compression level (1-9).
+ * @param arena  Arena zlib's internal state and the output buffer are allocated from,
+ *               or NULL to use malloc() and the pool. The arena must outlive the stream.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+int compress_stream_init(CompressStream *stream, Output *output, int sock, encoding_t enc, int level, Arena *arena);
+
+
+/**
+ * @brief Feeds data into a streaming compressor.
+ *
+ * Every COMPRESS_CHUNK_SIZE bytes of compressed output are sent as one HTTP chunk.
+ * When `finish` is set the remaining output, the zero-length terminating chunk
+ * and the trailer are written.
+ *
+ * @param stream The stream.
+ * @param data   Input data (may be NULL when `len` is 0).
+ * @param len    Length of the input data.
+ * @param finish Non-zero if this is the last piece of input.
+ *
+ * @return 1 on success, 0 on a compression or socket error.
+ */
+int compress_stream_write(CompressStream *stream, const char *data, size_t len, int finish);
+
+
+/**
+ * @brief Releases the resources held by a streaming compressor.
+ *
+ * @param stream The stream. Safe to call on an inactive stream.
+ */
+void compress_stream_end(CompressStream *stream);
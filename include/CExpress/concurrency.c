@@ -0,0 +1,91 @@
+/**
+ * @file concurrency.c
+ * @brief Implementation of the adaptive concurrency limit.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-28
+ */
+
+#include "concurrency.h"
+
+#include <math.h>
+
+
+/**
+ * @brief Initializes an adaptive limit, starting at its maximum.
+ */
+void concurrency_init(ConcurrencyLimit *cl, int min_limit, int max_limit) {
+    cl->min_limit = (min_limit < 1) ? 1 : min_limit;
+    cl->max_limit = (max_limit < cl->min_limit) ? cl->min_limit : max_limit;
+    cl->limit = cl->max_limit;
+    cl->in_flight = 0;
+    cl->short_us = 0;
+    cl->long_us = 0;
+    cl->samples = 0;
+    cl->rejected = 0;
+}
+
+
+/**
+ * @brief Admits a request if fewer than `limit - reserved` are in flight.
+ *
+ * @return 1 if admitted, 0 if it must be rejected.
+ */
+int concurrency_acquire(ConcurrencyLimit *cl, int reserved) {
+    int usable = (int)cl->limit - reserved;
+    if (usable < 1) {
+        usable = 1; // a small limit only adapts on release: leave every request a slot
+    }
+    if (cl->in_flight >= usable) {
+        cl->rejected++;
+        return 0;
+    }
+    cl->in_flight++;
+    return 1;
+}
+
+
+/**
+ * @brief Completes an admitted request and adapts the limit to its latency.
+ */
+void concurrency_release(ConcurrencyLimit *cl, long long latency_us) {
+    if (cl->in_flight > 0) {
+        cl->in_flight--;
+    }
+
+    double sample = (latency_us > 0) ? (double)latency_us : 1.0;
+    if (cl->samples++ == 0) {
+        cl->short_us = sample;
+        cl->long_us = sample;
+        return;
+    }
+    cl->short_us += (sample - cl->short_us) / CONCURRENCY_SHORT_WINDOW;
+    cl->long_us += (sample - cl->long_us) / CONCURRENCY_LONG_WINDOW;
+
+    // After an overload the baseline is inflated: let it recover toward recent latency.
+    if (cl->long_us > 2 * cl->short_us) {
+        cl->long_us *= 0.95;
+    }
+    if (cl->samples < CONCURRENCY_SHORT_WINDOW) {
+        return; // not enough history for a meaningful estimate
+    }
+
+    double gradient = CONCURRENCY_TOLERANCE * cl->long_us / cl->short_us;
+    if (gradient > 1.0) gradient = 1.0;
+    if (gradient < CONCURRENCY_MIN_GRADIENT) gradient = CONCURRENCY_MIN_GRADIENT;
+
+    double estimate = cl->limit * gradient + sqrt(cl->limit); // room for a small queue
+    cl->limit = cl->limit * (1 - CONCURRENCY_SMOOTHING) + estimate * CONCURRENCY_SMOOTHING;
+    if (cl->limit < cl->min_limit) cl->limit = cl->min_limit;
+    if (cl->limit > cl->max_limit) cl->limit = cl->max_limit;
+}
+
+
+/**
+ * @brief Releases an admitted request that was dropped before being served.
+ */
+void concurrency_abandon(ConcurrencyLimit *cl) {
+    if (cl->in_flight > 0) {
+        cl->in_flight--;
+    }
+}
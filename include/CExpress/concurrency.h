@@ -0,0 +1,83 @@
+/**
+ * @file concurrency.h
+ * @brief Adaptive limit on requests in flight, driven by measured latency.
+ *
+ * Requests read from clients during one pass of the event loop queue behind
+ * each other, so the number admitted per pass is the server's concurrency.
+ * The limit follows a gradient algorithm: a short-term latency average is
+ * compared to a long-term baseline. While they agree the limit grows by about
+ * its square root, and as latency rises above the baseline the limit shrinks
+ * proportionally. Requests beyond the limit are rejected up front instead of
+ * waiting in a queue that would only make everyone late.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-28
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+// User defined constants
+#define CONCURRENCY_SHORT_WINDOW 10    // samples averaged into the recent latency
+#define CONCURRENCY_LONG_WINDOW 500    // samples averaged into the baseline latency
+#define CONCURRENCY_TOLERANCE 2.0      // recent latency may reach this multiple of the baseline before the limit shrinks
+#define CONCURRENCY_SMOOTHING 0.2      // weight of each new limit estimate
+#define CONCURRENCY_MIN_GRADIENT 0.5   // the limit shrinks by at most this factor per estimate
+
+
+/**
+ * @struct ConcurrencyLimit
+ * @brief State of an adaptive concurrency limit.
+ */
+typedef struct {
+    double limit;             // current limit on requests in flight
+    int min_limit;            // the limit never goes below this (0 when disabled)
+    int max_limit;            // the limit never goes above this
+    int in_flight;            // requests admitted and not yet completed
+    double short_us;          // recent latency (exponential moving average)
+    double long_us;           // baseline latency (exponential moving average)
+    size_t samples;           // completed requests measured
+    size_t rejected;          // requests rejected for being over the limit
+} ConcurrencyLimit;
+
+
+/**
+ * @brief Initializes an adaptive limit, starting at its maximum.
+ *
+ * @param cl        The limit to initialize.
+ * @param min_limit Lower bound of the limit (at least 1).
+ * @param max_limit Upper bound of the limit.
+ */
+void concurrency_init(ConcurrencyLimit *cl, int min_limit, int max_limit);
+
+
+/**
+ * @brief Admits a request if fewer than `limit - reserved` are in flight.
+ *
+ * @param cl       The limit.
+ * @param reserved Part of the limit this request may not use (kept for more important requests).
+ *                 It never takes the last slot, so every request can run once nothing else is in flight.
+ * @return 1 if admitted (release it with concurrency_release()), 0 if it must be rejected.
+ */
+int concurrency_acquire(ConcurrencyLimit *cl, int reserved);
+
+
+/**
+ * @brief Completes an admitted request and adapts the limit to its latency.
+ *
+ * @param cl         The limit.
+ * @param latency_us Time from the request's arrival to its response, in microseconds.
+ */
+void concurrency_release(ConcurrencyLimit *cl, long long latency_us);
+
+
+/**
+ * @brief Releases an admitted request that was dropped before being served.
+ *
+ * Its latency says nothing about the server's capacity, so the limit is left as is.
+ *
+ * @param cl The limit.
+ */
+void concurrency_abandon(ConcurrencyLimit *cl);
@@ -1,39 +1,329 @@
 #include "handlers.h"
+#include "server.h"
+
+#include <sys/uio.h>
+
+
+/**
+ * @brief Resolves the compression level for a route (route override or server default).
+ */
+static int route_compress_level(const Server *server, const Router *route) {
+    return (route->compress_level < 0) ? server->compress_level : route->compress_level;
+}
+
+
+/**
+ * @brief Formats the response header for a body of known length.
+ *
+ * @return The header length, or 0 if it did not fit in `out`.
+ */
+static size_t build_header(char *out, size_t out_size, size_t len, encoding_t enc, int vary, int close) {
+    char extra[128];
+    snprintf(extra, sizeof(extra), "%s%s%s%s%s",
+             enc != ENC_IDENTITY ? "Content-Encoding: " : "",
+             enc != ENC_IDENTITY ? encoding_name(enc) : "",
+             enc != ENC_IDENTITY ? "\r\n" : "",
+             vary ? "Vary: Accept-Encoding\r\n" : "",
+             close ? "Connection: close\r\n" : "");
+    return format_http_header(out, out_size, len, extra);
+}
+
+
+/**
+ * @brief Sends a complete response body with a Content-Length header.
+ *
+ * Header and body go out in a single vectored write. What the socket does not
+ * accept is sent later from `body` itself when the output may keep it
+ * (`release` given), and copied into the connection's output otherwise.
+ *
+ * @param req     The request (its socket, output and whether the connection closes).
+ * @param body    The body bytes.
+ * @param len     Length of the body.
+ * @param enc     Content coding of `body`.
+ * @param vary    Non-zero to add "Vary: Accept-Encoding".
+ * @param release Frees `body` once sent: the body then belongs to the output,
+ *                even on failure. NULL if the caller keeps it.
+ *
+ * @return 1 if the response was sent, 0 otherwise.
+ */
+static int send_body(const Request *req, char *body, size_t len, encoding_t enc, int vary, OutputRelease release) {
+    Output *out = req->out;
+    int sock = req->client_sock;
+    char header[256];
+    size_t header_len = build_header(header, sizeof(header), len, enc, vary, req->close);
+    ssize_t sent = 0;
+    if (header_len > 0 && !output_pending(out)) {
+        struct iovec iov[2] = {
+            { .iov_base = header,       .iov_len = header_len },
+            { .iov_base = (void *)body, .iov_len = len },
+        };
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+        sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+        if (sent < 0 && out && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            sent = 0; // socket full: everything goes through the output
+        }
+    }
+    if (header_len == 0 || sent < 0
+        || ((size_t)sent < header_len && output_write(out, sock, header + sent, header_len - sent) < 0)) {
+        if (release) release(body, len);
+        return 0;
+    }
+    size_t body_sent = ((size_t)sent > header_len) ? sent - header_len : 0;
+    if (release) {
+        return output_send_body(out, sock, body, body_sent, len, release) >= 0;
+    }
+    return output_write(out, sock, body + body_sent, len - body_sent) >= 0;
+}
+
+
+/**
+ * @brief Sends a cached body representation with a Content-Length header.
+ *
+ * memfd-backed bodies get their header written first and the body sent with
+ * sendfile(); in-memory bodies go through send_body().
+ *
+ * @return 1 if the response was sent, 0 otherwise.
+ */
+static int send_cached_body(const Request *req, const CachedBody *body, encoding_t enc, int vary) {
+    if (body->fd < 0) {
+        return send_body(req, body->data, body->len, enc, vary, NULL); // the cache may evict it: copy
+    }
+
+    char header[256];
+    size_t header_len = build_header(header, sizeof(header), body->len, enc, vary, req->close);
+    if (header_len == 0) return 0;
+
+    return output_write(req->out, req->client_sock, header, header_len) >= 0
+        && cached_body_send(req->out, req->client_sock, body);
+}
+
+
+/**
+ * @brief Streams a body compressed on the fly using chunked transfer encoding.
+ *
+ * Avoids holding a second, compressed copy of an uncached body in memory.
+ *
+ * @return 1 if the response was sent, 0 if it failed after the header went out,
+ *         -1 if the compressor could not be set up (nothing was sent).
+ */
+static int send_compressed_stream(const Request *req, const char *body, size_t len, encoding_t enc, int level) {
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: text/plain\r\n"
+                              "Content-Encoding: %s\r\n"
+                              "Vary: Accept-Encoding\r\n"
+                              "Transfer-Encoding: chunked\r\n"
+                              "%s"
+                              "\r\n",
+                              encoding_name(enc), req->close ? "Connection: close\r\n" : "");
+
+    CompressStream stream;
+    if (!compress_stream_init(&stream, req->out, req->client_sock, enc, level, req->arena)) return -1;
+
+    int ok = output_write(req->out, req->client_sock, header, header_len) >= 0
+          && compress_stream_write(&stream, body, len, 1);
+    compress_stream_end(&stream);
+    return ok;
+}
+
+
+/**
+ * @brief Runs a route's handler with the request published to the handler thread.
+ *
+ * The body's size is recorded in the route's histogram, which is what
+ * cx_response_buffer() presizes buffers from.
+ *
+ * @param req The request context.
+ * @param len Receives the length of the body.
+ * @return The handler's body (malloc()ed or from the request arena), or NULL.
+ */
+static char *run_handler(Request *req, size_t *len) {
+    request_set_current(req);
+    char *body = req->route->handler();
+    request_set_current(NULL);
+    if (body) {
+        *len = strlen(body);
+        size_hist_record(&req->route->sizes, *len + 1);
+    }
+    return body;
+}
+
+
+/**
+ * @brief Answers 504 instead of the handler's body if the request's deadline has passed.
+ *
+ * The 504 says "Connection: close", so the request is marked to close the
+ * connection once it is flushed.
+ *
+ * @return 1 if the deadline had passed and the 504 was sent, 0 otherwise.
+ */
+static int send_if_expired(Request *req) {
+    if (req->deadline_us == 0 || now_us() < req->deadline_us) {
+        return 0;
+    }
+    req->server->timed_out++;
+    req->close = 1;
+    output_write(req->out, req->client_sock, RESPONSE_GATEWAY_TIMEOUT, strlen(RESPONSE_GATEWAY_TIMEOUT));
+    return 1;
+}
+
+
+/**
+ * @brief Releases a handler body unless it lives in the request arena.
+ */
+static void release_body(Request *req, char *body) {
+    if (!req->arena || !arena_owns(req->arena, body)) {
+        free(body);
+    }
+}
+
+
+/**
+ * @brief OutputRelease for malloc()ed handler bodies.
+ */
+static void release_heap(char *body, size_t size) {
+    (void)size;
+    free(body);
+}
+
+
+/**
+ * @brief OutputRelease for bodies produced by compress_buffer().
+ */
+static void release_compressed(char *body, size_t size) {
+    cx_free(MEM_COMPRESS, body, size);
+}
+
+
+/**
+ * @brief Sends a handler's body as identity, handing it to the connection's output.
+ *
+ * malloc()ed bodies are sent from in place however long the client takes. Arena
+ * bodies are reused by the next request: one that may outlast its request
+ * and does not fit the output's buffer is moved to the heap first.
+ *
+ * @return 1 if the response was sent, 0 otherwise. The body is released either way.
+ */
+static int send_handler_body(Request *req, char *body, size_t len, int vary) {
+    if (!req->arena || !arena_owns(req->arena, body)) {
+        return send_body(req, body, len, ENC_IDENTITY, vary, release_heap);
+    }
+    if (!req->out || req->out->limit == 0 || len <= req->out->limit) {
+        return send_body(req, body, len, ENC_IDENTITY, vary, NULL); // sent or buffered before the arena resets
+    }
+    char *copy = malloc(len);
+    if (!copy) {
+        fprintf(stderr, "Out of memory for a %zu-byte body. Response dropped.\n", len);
+        return 0;
+    }
+    memcpy(copy, body, len);
+    return send_body(req, copy, len, ENC_IDENTITY, vary, release_heap);
+}
+
+
+/**
+ * @brief Sends a handler's body, compressed if the client accepts it.
+ *
+ * Bodies the output could not buffer once compressed are compressed whole and
+ * sent from the compressed copy; others stream as chunks.
+ *
+ * @return 1 if the response was sent, 0 otherwise. The body is released either way.
+ */
+static int send_handler_response(Request *req, char *body, size_t len, encoding_t enc, int level) {
+    Server *server = req->server;
+    int ok = -1;
+    if (enc != ENC_IDENTITY && len >= server->compress_min_size) {
+        if (req->out && req->out->limit > 0 && len > req->out->limit / 2) {
+            size_t zlen = 0;
+            char *zbody = compress_buffer(body, len, enc, level, &zlen);
+            if (zbody) {
+                ok = send_body(req, zbody, zlen, enc, 1, release_compressed);
+            }
+        } else {
+            ok = send_compressed_stream(req, body, len, enc, level);
+        }
+    }
+    if (ok == -1) {
+        // Identity requested, body too small, or no memory for a compressor.
+        return send_handler_body(req, body, len, level > 0);
+    }
+    release_body(req, body);
+    return ok;
+}
 
 
 /**
- * @brief Executes the specified route handler and sends an HTTP response to the client.
+ * @brief Executes the matched route handler and sends an HTTP response to the client.
  *
  * This function:
- * 1. Invokes the route's handler function to generate the response body.
- * 2. Constructs a valid HTTP/1.1 response by adding headers via `add_http_header`.
- * 3. Sends the complete response (headers + body) through the client's socket.
- * 4. Frees any dynamically allocated memory used in the process.
+ * 1. Serves cacheable routes from the response cache, running the handler only on a miss.
+ * 2. Negotiates gzip/deflate from the request's Accept-Encoding header.
+ * 3. Sends the response: cached variants with Content-Length, uncached compressed bodies
+ *    as a chunked stream, everything else as identity. A handler that ran past the
+ *    request's deadline gets a 504 instead.
+ * 4. Hands the handler's body to the connection's output, which frees it once the
+ *    client has read it, unless it was allocated with cx_alloc(); arena memory
+ *    is released by the server once the response has been sent.
  *
- * @param header      The original HTTP request header (optional, useful for logging or debugging).
- * @param client_sock The socket file descriptor of the connected client.
- * @param handler     The function pointer to the route handler responsible for generating the response body.
+ * @param req The request context. `req->route` must point to the matched route.
  *
  * @return 1 if the response was successfully sent,
  *         0 if an error occurred while executing the handler or sending the response.
  */
-int execute_handler(const char *header, int client_sock, HandlerFunc handler) {
-    if (client_sock == -1 || !handler) return 0;
+int execute_handler(Request *req) {
+    Router *route = req->route;
+    Server *server = req->server;
+    if (req->client_sock == -1 || !route || !route->handler || !server) return 0;
 
-    // Call the handler
-    char *handler_str = handler();
-    if (!handler_str) return 0;
+    int level = route_compress_level(server, route);
+    encoding_t enc = ENC_IDENTITY;
+    if (level > 0) {
+        char accept_encoding[128];
+        if (get_header_value(req->header, "Accept-Encoding", accept_encoding, sizeof(accept_encoding))) {
+            enc = negotiate_encoding(accept_encoding);
+        }
+    }
 
-    // Construct HTTP/1.1 response
-    char *response = add_http_header(handler_str, strlen(handler_str));
-    free(handler_str);
+    if (route->cache_ttl_ms > 0) {
+        long long now = now_ms();
+        CacheEntry *entry = cache_lookup(&server->cache, route->method, route->path, now);
+        if (!entry) {
+            size_t len = 0;
+            char *handler_str = run_handler(req, &len);
+            if (!handler_str) return 0;
 
-    if (!response) return 0;
-    
-    // Send response to client
-    ssize_t sent = write(client_sock, response, strlen(response));
-    free(response);
+            entry = cache_store(&server->cache, route->method, route->path, handler_str, len,
+                                now + route->cache_ttl_ms, level > 0 ? level : COMPRESS_DEFAULT_LEVEL);
+            if (!entry) {
+                // Too large to cache: serve it once, as an uncached route would.
+                if (send_if_expired(req)) {
+                    release_body(req, handler_str);
+                    return 1;
+                }
+                return send_handler_response(req, handler_str, len, enc, level);
+            }
+            release_body(req, handler_str); // the cache keeps its own copy
+            if (send_if_expired(req)) {
+                return 1; // cached for later requests, but too late for this one
+            }
+        }
 
-    return (sent > 0) ? 1 : 0;
-}
+        if (entry->variants[ENC_IDENTITY].len < server->compress_min_size) {
+            enc = ENC_IDENTITY;
+        }
+        const CachedBody *body = cache_variant(&server->cache, entry, &enc);
+        return send_cached_body(req, body, enc, level > 0);
+    }
 
+    // Call the handler
+    size_t len = 0;
+    char *handler_str = run_handler(req, &len);
+    if (!handler_str) return 0;
+    if (send_if_expired(req)) {
+        release_body(req, handler_str);
+        return 1;
+    }
+
+    return send_handler_response(req, handler_str, len, enc, level);
+}
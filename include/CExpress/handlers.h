@@ -13,6 +13,7 @@
 #pragma once
 
 #include "utils.h"
+#include "request.h"
 
 
 /**
@@ -23,6 +24,7 @@
  * 
  * @return A dynamically allocated string (usually JSON or HTML) representing the response body.
  *         The caller (server/framework) is responsible for freeing this string after use.
+ *         Bodies allocated with cx_alloc() are released with the request instead.
  *
  * @note The handler takes no parameters. All necessary information should already be available 
  *       in the context in which it is executed.
@@ -31,19 +33,20 @@ typedef char *(*HandlerFunc)(void);
 
 
 /**
- * @brief Executes the specified route handler and sends the generated HTTP response to the client.
+ * @brief Executes the matched route handler and sends the generated HTTP response to the client.
  *
  * This function:
- * 1. Calls the route's handler function to generate the response body.
- * 2. Constructs an HTTP/1.1-compliant response by adding the appropriate headers using `add_http_header`.
- * 3. Sends the complete response (headers + body) to the client via the provided socket.
+ * 1. Serves the response from the server's response cache if the route is cacheable and a live entry exists,
+ *    otherwise calls the route's handler function to generate the response body.
+ * 2. Negotiates a content coding from the request's Accept-Encoding header and compresses bodies at least
+ *    as large as the server's minimum compression size.
+ * 3. Sends the complete response (headers + body) to the client via the request's socket. Uncached
+ *    compressed bodies are streamed with chunked transfer encoding.
  * 4. Frees any dynamically allocated memory used during the process.
  *
- * @param header      The original HTTP request header (optional, can be used for logging or context).
- * @param client_sock The socket file descriptor of the connected client.
- * @param handler     The function pointer to the route handler responsible for generating the response body.
+ * @param req The request context. `req->route` must point to the matched route.
  *
  * @return 1 if the response was successfully sent, 
  *         0 if an error occurred during execution or sending.
  */
-int execute_handler(const char *header, int client_sock, HandlerFunc handler);
+int execute_handler(Request *req);
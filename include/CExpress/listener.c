@@ -0,0 +1,246 @@
+/**
+ * @file listener.c
+ * @brief Implementation of listening endpoints.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#include "listener.h"
+#include "utils.h"
+
+#include <stddef.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+
+/**
+ * @brief Parses a TCP port number.
+ *
+ * @return The port, or -1 if `text` is not one.
+ */
+static int parse_port(const char *text) {
+    char *end;
+    long port = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || port <= 0 || port > 65535) {
+        return -1;
+    }
+    return (int)port;
+}
+
+
+/**
+ * @brief Parses an endpoint.
+ *
+ * @return 1 on success, 0 if the endpoint is malformed.
+ */
+int listener_parse(const char *endpoint, struct sockaddr_storage *addr, socklen_t *len) {
+    memset(addr, 0, sizeof(*addr));
+
+    if (strncmp(endpoint, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)addr;
+        const char *path = endpoint + 5;
+        size_t path_len = strlen(path);
+        if (path_len == 0 || path_len >= sizeof(un->sun_path)) {
+            return 0;
+        }
+        un->sun_family = AF_UNIX;
+        if (path[0] == '@') {
+            // Abstract namespace: a leading NUL, and the name is not NUL-terminated.
+            memcpy(un->sun_path + 1, path + 1, path_len - 1);
+            *len = offsetof(struct sockaddr_un, sun_path) + path_len;
+        } else {
+            memcpy(un->sun_path, path, path_len);
+            *len = offsetof(struct sockaddr_un, sun_path) + path_len + 1;
+        }
+        return 1;
+    }
+
+    char host[64];
+    const char *port;
+    if (endpoint[0] == '[') {
+        const char *close = strstr(endpoint, "]:");
+        if (!close || (size_t)(close - endpoint - 1) >= sizeof(host)) {
+            return 0;
+        }
+        memcpy(host, endpoint + 1, close - endpoint - 1);
+        host[close - endpoint - 1] = '\0';
+        port = close + 2;
+
+        struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)addr;
+        in6->sin6_family = AF_INET6;
+        if (parse_port(port) == -1 || inet_pton(AF_INET6, host, &in6->sin6_addr) != 1) {
+            return 0;
+        }
+        in6->sin6_port = htons(parse_port(port));
+        *len = sizeof(*in6);
+        return 1;
+    }
+
+    const char *colon = strrchr(endpoint, ':');
+    if (!colon || (size_t)(colon - endpoint) >= sizeof(host)) {
+        return 0;
+    }
+    memcpy(host, endpoint, colon - endpoint);
+    host[colon - endpoint] = '\0';
+    port = colon + 1;
+
+    struct sockaddr_in *in = (struct sockaddr_in *)addr;
+    in->sin_family = AF_INET;
+    if (parse_port(port) == -1 || inet_pton(AF_INET, host, &in->sin_addr) != 1) {
+        return 0;
+    }
+    in->sin_port = htons(parse_port(port));
+    *len = sizeof(*in);
+    return 1;
+}
+
+
+/**
+ * @brief Removes a socket file left behind at a Unix path by a process that is gone.
+ *
+ * @return 1 if the path is free, 0 if a process still listens on it.
+ */
+static int clear_stale_path(const struct sockaddr_un *un, socklen_t len) {
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe == -1) {
+        return 1; // let bind() report the problem
+    }
+    int in_use = connect(probe, (const struct sockaddr *)un, len) == 0;
+    int refused = !in_use && errno == ECONNREFUSED;
+    close(probe);
+    if (in_use) {
+        return 0;
+    }
+    if (refused) {
+        unlink(un->sun_path);
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Creates a stream socket bound to an address.
+ *
+ * @return The socket, or -1 on failure.
+ */
+int listener_open(const struct sockaddr *addr, socklen_t len) {
+    int fd = socket(addr->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("socket creation failed.");
+        return -1;
+    }
+
+    int opt = 1;
+    if (addr->sa_family != AF_UNIX && setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt failed.");
+        close(fd);
+        return -1;
+    }
+    if (addr->sa_family == AF_INET6 && setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt failed.");
+        close(fd);
+        return -1;
+    }
+
+    const struct sockaddr_un *un = (const struct sockaddr_un *)addr;
+    if (addr->sa_family == AF_UNIX && un->sun_path[0] != '\0' && !clear_stale_path(un, len)) {
+        fprintf(stderr, "%s is in use by another process.\n", un->sun_path);
+        close(fd);
+        return -1;
+    }
+
+    if (bind(fd, addr, len) == -1) {
+        perror("socket binding failed.");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/**
+ * @brief Tells whether a socket is a listening stream socket bound to an address.
+ *
+ * @return 1 if it is, 0 otherwise.
+ */
+int listener_matches(int fd, const struct sockaddr *addr, socklen_t len) {
+    struct sockaddr_storage bound;
+    socklen_t bound_len = sizeof(bound);
+    int listening = 0;
+    socklen_t opt_len = sizeof(listening);
+    if (getsockname(fd, (struct sockaddr *)&bound, &bound_len) == -1 || bound.ss_family != addr->sa_family
+        || getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &opt_len) == -1 || !listening) {
+        return 0;
+    }
+
+    if (addr->sa_family == AF_INET) {
+        const struct sockaddr_in *a = (const struct sockaddr_in *)&bound;
+        const struct sockaddr_in *b = (const struct sockaddr_in *)addr;
+        return a->sin_port == b->sin_port && a->sin_addr.s_addr == b->sin_addr.s_addr;
+    }
+    if (addr->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *a = (const struct sockaddr_in6 *)&bound;
+        const struct sockaddr_in6 *b = (const struct sockaddr_in6 *)addr;
+        return a->sin6_port == b->sin6_port && memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+    }
+    if (addr->sa_family == AF_UNIX) {
+        const struct sockaddr_un *a = (const struct sockaddr_un *)&bound;
+        const struct sockaddr_un *b = (const struct sockaddr_un *)addr;
+        if (b->sun_path[0] == '\0') {
+            return bound_len == len && memcmp(a->sun_path, b->sun_path, len - offsetof(struct sockaddr_un, sun_path)) == 0;
+        }
+        return strncmp(a->sun_path, b->sun_path, sizeof(a->sun_path)) == 0;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Takes the socket bound to an address out of a set of handed-down sockets.
+ *
+ * @return The socket, or -1 if none matches.
+ */
+int listener_take(int *fds, int count, const struct sockaddr *addr, socklen_t len) {
+    for (int i = 0; i < count; i++) {
+        if (fds[i] != -1 && listener_matches(fds[i], addr, len)) {
+            int fd = fds[i];
+            fds[i] = -1;
+            return fd;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Writes the endpoint a socket is bound to, in the form listener_parse() reads.
+ */
+void listener_name(int fd, char *out, size_t size) {
+    struct sockaddr_storage bound;
+    socklen_t bound_len = sizeof(bound);
+    char host[INET6_ADDRSTRLEN];
+    snprintf(out, size, "fd:%d", fd);
+    if (getsockname(fd, (struct sockaddr *)&bound, &bound_len) == -1) {
+        return;
+    }
+
+    if (bound.ss_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)&bound;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        snprintf(out, size, "%s:%d", host, ntohs(in->sin_port));
+    } else if (bound.ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)&bound;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        snprintf(out, size, "[%s]:%d", host, ntohs(in6->sin6_port));
+    } else if (bound.ss_family == AF_UNIX) {
+        const struct sockaddr_un *un = (const struct sockaddr_un *)&bound;
+        int path_len = (int)(bound_len - offsetof(struct sockaddr_un, sun_path));
+        if (path_len > 0 && un->sun_path[0] == '\0') {
+            snprintf(out, size, "unix:@%.*s", path_len - 1, un->sun_path + 1);
+        } else {
+            snprintf(out, size, "unix:%.*s", path_len, un->sun_path);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ * @file listener.h
+ * @brief Listening endpoints: TCP over IPv4 or IPv6, and Unix domain stream sockets.
+ *
+ * An endpoint is written as:
+ *  - `127.0.0.1:8080` or `0.0.0.0:8080` for IPv4,
+ *  - `[::1]:8080` or `[::]:8080` for IPv6 (IPv6 only, so it can sit next to an IPv4 wildcard),
+ *  - `unix:/run/app.sock` for a Unix socket at a path,
+ *  - `unix:@app` for a Unix socket in the Linux abstract namespace.
+ *
+ * A process on the same host reaches a Unix socket without going through the
+ * TCP loopback stack.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+
+// User defined constants
+#define LISTENER_NAME_SIZE 112     // room for the longest endpoint name (a full Unix socket path)
+
+
+/**
+ * @struct Listener
+ * @brief A listening socket of a Server and its counters.
+ */
+typedef struct {
+    int fd;                       // listening socket, -1 once closed
+    char name[LISTENER_NAME_SIZE]; // endpoint the socket is bound to
+    size_t accepted;              // connections accepted
+    size_t refused;               // connections turned away (rate limit, no slot left)
+    int active;                   // connections currently open
+} Listener;
+
+
+/**
+ * @brief Parses an endpoint.
+ *
+ * @param endpoint The endpoint, in one of the forms listed above.
+ * @param addr     Receives the socket address.
+ * @param len      Receives the length of the address.
+ * @return 1 on success, 0 if the endpoint is malformed.
+ */
+int listener_parse(const char *endpoint, struct sockaddr_storage *addr, socklen_t *len);
+
+
+/**
+ * @brief Creates a stream socket bound to an address.
+ *
+ * TCP sockets get SO_REUSEADDR. A socket file left at a Unix path by a process
+ * that is gone is removed first; a path some process still listens on is not.
+ *
+ * @param addr The address.
+ * @param len  Length of the address.
+ * @return The socket (close-on-exec, not yet listening), or -1 on failure.
+ */
+int listener_open(const struct sockaddr *addr, socklen_t len);
+
+
+/**
+ * @brief Tells whether a socket is a listening stream socket bound to an address.
+ *
+ * @param fd   The socket.
+ * @param addr The address.
+ * @param len  Length of the address.
+ * @return 1 if it is, 0 otherwise.
+ */
+int listener_matches(int fd, const struct sockaddr *addr, socklen_t len);
+
+
+/**
+ * @brief Takes the socket bound to an address out of a set of handed-down sockets.
+ *
+ * @param fds   The sockets; the one taken is replaced by -1.
+ * @param count Number of sockets.
+ * @param addr  The address.
+ * @param len   Length of the address.
+ * @return The socket, or -1 if none matches.
+ */
+int listener_take(int *fds, int count, const struct sockaddr *addr, socklen_t len);
+
+
+/**
+ * @brief Writes the endpoint a socket is bound to, in the form listener_parse() reads.
+ *
+ * @param fd   The socket.
+ * @param out  Receives the endpoint.
+ * @param size Size of `out`.
+ */
+void listener_name(int fd, char *out, size_t size);
@@ -0,0 +1,326 @@
+/**
+ * @file loop.c
+ * @brief Implementation of user file descriptors and timers on a server's event loop.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#include "server.h"
+
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+
+static _Thread_local struct Server *current_server = NULL; // server whose loop runs on this thread
+
+
+/**
+ * @brief Opens the loop's timerfd (Linux).
+ */
+void loop_open(Loop *loop) {
+    loop->timer_fd = -1;
+    loop->armed_ms = 0;
+#ifdef __linux__
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->timer_fd == -1) {
+        perror("timerfd_create failed. Timers shorten the select() timeout instead.");
+    }
+#endif
+}
+
+
+/**
+ * @brief Closes the loop's timerfd.
+ */
+void loop_close(Loop *loop) {
+    if (loop->timer_fd != -1) {
+        close(loop->timer_fd);
+        loop->timer_fd = -1;
+    }
+}
+
+
+/**
+ * @brief Finds when the earliest pending timer is due.
+ *
+ * @return Its monotonic time in milliseconds, or 0 if no timer is pending.
+ */
+static long long loop_next_due(const Loop *loop) {
+    long long due = 0;
+    for (int i = 0; i < loop->num_timers; i++) {
+        if (loop->timers[i].id != 0 && (due == 0 || loop->timers[i].due_ms < due)) {
+            due = loop->timers[i].due_ms;
+        }
+    }
+    return due;
+}
+
+
+/**
+ * @brief Arms the timerfd for the earliest timer, or disarms it.
+ *
+ * The kernel call is skipped while the earliest deadline does not change.
+ */
+static void loop_arm(Loop *loop) {
+#ifdef __linux__
+    long long due = loop_next_due(loop);
+    if (due == loop->armed_ms) {
+        return;
+    }
+    struct itimerspec spec = { 0 };
+    spec.it_value.tv_sec = due / 1000;
+    spec.it_value.tv_nsec = (due % 1000) * 1000000; // all zero disarms
+    if (timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == 0) {
+        loop->armed_ms = due;
+    }
+#endif
+}
+
+
+/**
+ * @brief Adds the watched user descriptors to the sets of a select() call.
+ *
+ * @return Highest descriptor in the sets afterwards.
+ */
+int loop_fill(Loop *loop, fd_set *reads, fd_set *writes, int max_fd) {
+    if (loop->timer_fd != -1) {
+        loop_arm(loop);
+        FD_SET(loop->timer_fd, reads);
+        max_fd = (loop->timer_fd > max_fd) ? loop->timer_fd : max_fd;
+    }
+    for (int i = 0; i < loop->num_watches; i++) {
+        const LoopWatch *watch = &loop->watches[i];
+        if (watch->fd == -1 || watch->events == 0) {
+            continue;
+        }
+        if (watch->events & CX_EVENT_READ) {
+            FD_SET(watch->fd, reads);
+        }
+        if (watch->events & CX_EVENT_WRITE) {
+            FD_SET(watch->fd, writes);
+        }
+        max_fd = (watch->fd > max_fd) ? watch->fd : max_fd;
+    }
+    return max_fd;
+}
+
+
+/**
+ * @brief Runs the callbacks of the user descriptors select() found ready.
+ */
+void loop_dispatch(Loop *loop, const fd_set *reads, const fd_set *writes) {
+    if (loop->timer_fd != -1 && FD_ISSET(loop->timer_fd, reads)) {
+        uint64_t expirations;
+        read(loop->timer_fd, &expirations, sizeof(expirations)); // due timers run every pass
+        loop->armed_ms = 0; // fired: arm again for whatever is left
+    }
+    int count = loop->num_watches; // descriptors added by a callback wait for the next pass
+    for (int i = 0; i < count; i++) {
+        LoopWatch *watch = &loop->watches[i];
+        if (watch->fd == -1) {
+            continue;
+        }
+        int events = 0;
+        if ((watch->events & CX_EVENT_READ) && FD_ISSET(watch->fd, reads)) {
+            events |= CX_EVENT_READ;
+        }
+        if ((watch->events & CX_EVENT_WRITE) && FD_ISSET(watch->fd, writes)) {
+            events |= CX_EVENT_WRITE;
+        }
+        if (events) {
+            watch->callback(watch->fd, events, watch->ctx);
+        }
+    }
+}
+
+
+/**
+ * @brief Stops watching descriptors that were closed without cx_loop_del_fd().
+ */
+void loop_drop_closed(Loop *loop) {
+    for (int i = 0; i < loop->num_watches; i++) {
+        if (loop->watches[i].fd != -1 && fcntl(loop->watches[i].fd, F_GETFD) == -1) {
+            fprintf(stderr, "Descriptor %d was closed while watched. No longer watched.\n", loop->watches[i].fd);
+            loop->watches[i].fd = -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Runs the timers that are due.
+ */
+void loop_run_timers(Loop *loop, long long now) {
+    int count = loop->num_timers; // timers added by a callback wait for the next pass
+    for (int i = 0; i < count; i++) {
+        LoopTimer *timer = &loop->timers[i];
+        if (timer->id == 0 || timer->due_ms > now) {
+            continue;
+        }
+        LoopTimerCallback callback = timer->callback;
+        void *ctx = timer->ctx;
+        timer->id = 0; // free before the call, so the callback may schedule again
+        callback(ctx);
+    }
+    while (loop->num_timers > 0 && loop->timers[loop->num_timers - 1].id == 0) {
+        loop->num_timers--;
+    }
+}
+
+
+/**
+ * @brief Shortens a select() timeout so the next timer fires on time.
+ *
+ * @return The timeout to use, in milliseconds.
+ */
+long loop_timeout_ms(const Loop *loop, long long now, long timeout_ms) {
+    if (loop->timer_fd != -1) {
+        return timeout_ms; // the timerfd wakes select()
+    }
+    for (int i = 0; i < loop->num_timers; i++) {
+        if (loop->timers[i].id == 0) {
+            continue;
+        }
+        long long left = loop->timers[i].due_ms - now;
+        if (left < timeout_ms) {
+            timeout_ms = (left > 0) ? (long)left : 0;
+        }
+    }
+    return timeout_ms;
+}
+
+
+/**
+ * @brief Publishes (or clears) the server whose loop runs on the calling thread.
+ */
+void loop_set_current(struct Server *server) {
+    current_server = server;
+}
+
+
+/**
+ * @brief Returns the server whose loop runs on the calling thread.
+ */
+struct Server *cx_loop_server(void) {
+    return current_server;
+}
+
+
+/**
+ * @brief Finds the entry watching a descriptor.
+ *
+ * @return The entry, or NULL if the descriptor is not watched.
+ */
+static LoopWatch *find_watch(Loop *loop, int fd) {
+    for (int i = 0; i < loop->num_watches; i++) {
+        if (loop->watches[i].fd == fd) {
+            return &loop->watches[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Watches a descriptor on the server's loop.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+int cx_loop_add_fd(struct Server *server, int fd, int events, LoopFdCallback callback, void *ctx) {
+    Loop *loop = &server->loop;
+    if (fd < 0 || fd >= FD_SETSIZE || !callback || find_watch(loop, fd)) {
+        return 0;
+    }
+    LoopWatch *watch = find_watch(loop, -1); // reuse a freed entry first
+    if (!watch) {
+        if (loop->num_watches == LOOP_MAX_FDS) {
+            return 0;
+        }
+        watch = &loop->watches[loop->num_watches++];
+    }
+    watch->fd = fd;
+    watch->events = events;
+    watch->callback = callback;
+    watch->ctx = ctx;
+    return 1;
+}
+
+
+/**
+ * @brief Changes the events a watched descriptor is waited for.
+ *
+ * @return 1 on success, 0 if the descriptor is not watched.
+ */
+int cx_loop_mod_fd(struct Server *server, int fd, int events) {
+    LoopWatch *watch = (fd >= 0) ? find_watch(&server->loop, fd) : NULL;
+    if (!watch) {
+        return 0;
+    }
+    watch->events = events;
+    return 1;
+}
+
+
+/**
+ * @brief Stops watching a descriptor.
+ *
+ * @return 1 on success, 0 if the descriptor is not watched.
+ */
+int cx_loop_del_fd(struct Server *server, int fd) {
+    LoopWatch *watch = (fd >= 0) ? find_watch(&server->loop, fd) : NULL;
+    if (!watch) {
+        return 0;
+    }
+    watch->fd = -1; // entries stay in place: loop_dispatch() may be walking them
+    return 1;
+}
+
+
+/**
+ * @brief Schedules a one-shot timer on the server's loop.
+ *
+ * @return The timer's id, or 0 on failure.
+ */
+long cx_loop_add_timer(struct Server *server, long delay_ms, LoopTimerCallback callback, void *ctx) {
+    Loop *loop = &server->loop;
+    if (!callback) {
+        return 0;
+    }
+    LoopTimer *timer = NULL;
+    for (int i = 0; i < loop->num_timers && !timer; i++) {
+        if (loop->timers[i].id == 0) {
+            timer = &loop->timers[i];
+        }
+    }
+    if (!timer) {
+        if (loop->num_timers == LOOP_MAX_TIMERS) {
+            return 0;
+        }
+        timer = &loop->timers[loop->num_timers++];
+    }
+    timer->id = ++loop->next_timer_id;
+    timer->due_ms = now_ms() + (delay_ms > 0 ? delay_ms : 0);
+    timer->callback = callback;
+    timer->ctx = ctx;
+    return timer->id;
+}
+
+
+/**
+ * @brief Cancels a pending timer.
+ *
+ * @return 1 on success, 0 if the timer already fired or does not exist.
+ */
+int cx_loop_cancel_timer(struct Server *server, long id) {
+    Loop *loop = &server->loop;
+    for (int i = 0; i < loop->num_timers && id > 0; i++) {
+        if (loop->timers[i].id == id) {
+            loop->timers[i].id = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file loop.h
+ * @brief User file descriptors and timers on a server's event loop.
+ *
+ * Handlers and integrations (database clients, pipes, other services) can have
+ * their own descriptors watched by the select() that serves HTTP clients, and
+ * schedule one-shot timers, instead of running a thread of their own. Callbacks
+ * run on the server's loop thread, between requests, so they must not block.
+ *
+ * These functions are not thread-safe: call them from the server's loop thread
+ * (handlers, callbacks) or before server_start(). Other threads hand work to
+ * the loop with cx_loop_post() (see server.h).
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#pragma once
+
+#include <sys/select.h>
+
+
+// User defined constants
+#define LOOP_MAX_FDS 64            // user descriptors a server can watch
+#define LOOP_MAX_TIMERS 64         // timers a server can have pending
+#define LOOP_MAX_POSTS 64          // callbacks other threads can have waiting (see cx_loop_post())
+
+#define CX_EVENT_READ 1            // the descriptor is readable (or at end-of-file)
+#define CX_EVENT_WRITE 2           // the descriptor is writable
+
+struct Server;
+
+
+/**
+ * @typedef LoopFdCallback
+ * @brief Called when a watched descriptor is ready.
+ *
+ * @param fd     The descriptor.
+ * @param events CX_EVENT_READ and/or CX_EVENT_WRITE, as they occurred.
+ * @param ctx    The pointer given when the descriptor was added.
+ */
+typedef void (*LoopFdCallback)(int fd, int events, void *ctx);
+
+
+/**
+ * @typedef LoopTimerCallback
+ * @brief Called once when a timer is due.
+ *
+ * @param ctx The pointer given when the timer was added.
+ */
+typedef void (*LoopTimerCallback)(void *ctx);
+
+
+/**
+ * @struct LoopWatch
+ * @brief A user descriptor watched by the loop.
+ */
+typedef struct {
+    int fd;                   // the descriptor, -1 for a free entry
+    int events;               // CX_EVENT_* the callback wants
+    LoopFdCallback callback;
+    void *ctx;
+} LoopWatch;
+
+
+/**
+ * @struct LoopTimer
+ * @brief A pending one-shot timer.
+ */
+typedef struct {
+    long id;                  // handle returned to the caller, 0 for a free entry
+    long long due_ms;         // monotonic time the timer fires
+    LoopTimerCallback callback;
+    void *ctx;
+} LoopTimer;
+
+
+/**
+ * @struct LoopPost
+ * @brief A callback another thread posted to the loop.
+ */
+typedef struct {
+    LoopTimerCallback callback;
+    void *ctx;
+} LoopPost;
+
+
+/**
+ * @struct Loop
+ * @brief User descriptors and timers of a server.
+ *
+ * Fixed-size, so servers in static memory budget mode can use it too.
+ * Timers are few: they are kept unsorted and scanned. On Linux the earliest
+ * one arms a timerfd, so deadlines wake select() like any other descriptor.
+ */
+typedef struct {
+    LoopWatch watches[LOOP_MAX_FDS];
+    int num_watches;          // entries of `watches` in use or freed (free ones have fd -1)
+    LoopTimer timers[LOOP_MAX_TIMERS];
+    int num_timers;           // entries of `timers` in use or freed (free ones have id 0)
+    long next_timer_id;       // id of the next timer, starting at 1
+    int timer_fd;             // timerfd armed for the earliest timer, -1 without one
+    long long armed_ms;       // deadline `timer_fd` is armed for, 0 while disarmed
+} Loop;
+
+
+/**
+ * @brief Opens the loop's timerfd (Linux). Without one, timers shorten the select() timeout.
+ *
+ * @param loop The loop.
+ */
+void loop_open(Loop *loop);
+
+
+/**
+ * @brief Closes the loop's timerfd.
+ *
+ * @param loop The loop.
+ */
+void loop_close(Loop *loop);
+
+
+/**
+ * @brief Adds the watched user descriptors to the sets of a select() call.
+ *
+ * The timerfd is armed for the earliest timer and added too.
+ *
+ * @param loop   The loop.
+ * @param reads  Set of descriptors watched for reading.
+ * @param writes Set of descriptors watched for writing.
+ * @param max_fd Highest descriptor already in the sets.
+ * @return Highest descriptor in the sets afterwards.
+ */
+int loop_fill(Loop *loop, fd_set *reads, fd_set *writes, int max_fd);
+
+
+/**
+ * @brief Runs the callbacks of the user descriptors select() found ready.
+ *
+ * @param loop   The loop.
+ * @param reads  Readable descriptors, as returned by select().
+ * @param writes Writable descriptors, as returned by select().
+ */
+void loop_dispatch(Loop *loop, const fd_set *reads, const fd_set *writes);
+
+
+/**
+ * @brief Stops watching descriptors that were closed without cx_loop_del_fd().
+ *
+ * select() fails with EBADF as long as one of them is in its sets.
+ *
+ * @param loop The loop.
+ */
+void loop_drop_closed(Loop *loop);
+
+
+/**
+ * @brief Runs the timers that are due.
+ *
+ * @param loop The loop.
+ * @param now  Current monotonic time in milliseconds.
+ */
+void loop_run_timers(Loop *loop, long long now);
+
+
+/**
+ * @brief Shortens a select() timeout so the next timer fires on time.
+ *
+ * Left unchanged when the timerfd wakes select() instead.
+ *
+ * @param loop       The loop.
+ * @param now        Current monotonic time in milliseconds.
+ * @param timeout_ms The timeout select() would otherwise use.
+ * @return The timeout to use, in milliseconds.
+ */
+long loop_timeout_ms(const Loop *loop, long long now, long timeout_ms);
+
+
+/**
+ * @brief Publishes (or clears) the server whose loop runs on the calling thread.
+ *
+ * @param server The server, or NULL once its loop has ended.
+ */
+void loop_set_current(struct Server *server);
+
+
+/**
+ * @brief Returns the server whose loop runs on the calling thread.
+ *
+ * Lets handlers and callbacks reach the loop without keeping the Server around.
+ *
+ * @return The server, or NULL outside of a server's loop thread.
+ */
+struct Server *cx_loop_server(void);
+
+
+/**
+ * @brief Watches a descriptor on the server's loop.
+ *
+ * The descriptor should be non-blocking. Remove it with cx_loop_del_fd()
+ * before closing it.
+ *
+ * @param server   The server.
+ * @param fd       The descriptor (below FD_SETSIZE).
+ * @param events   CX_EVENT_READ and/or CX_EVENT_WRITE.
+ * @param callback Called on the loop thread each time the descriptor is ready.
+ * @param ctx      Passed to the callback.
+ * @return 1 on success, 0 if the descriptor is invalid, already watched, or LOOP_MAX_FDS are.
+ */
+int cx_loop_add_fd(struct Server *server, int fd, int events, LoopFdCallback callback, void *ctx);
+
+
+/**
+ * @brief Changes the events a watched descriptor is waited for.
+ *
+ * @param server The server.
+ * @param fd     The descriptor.
+ * @param events CX_EVENT_READ and/or CX_EVENT_WRITE, or 0 to pause it.
+ * @return 1 on success, 0 if the descriptor is not watched.
+ */
+int cx_loop_mod_fd(struct Server *server, int fd, int events);
+
+
+/**
+ * @brief Stops watching a descriptor. Safe to call from its own callback.
+ *
+ * @param server The server.
+ * @param fd     The descriptor, which stays open.
+ * @return 1 on success, 0 if the descriptor is not watched.
+ */
+int cx_loop_del_fd(struct Server *server, int fd);
+
+
+/**
+ * @brief Schedules a one-shot timer on the server's loop.
+ *
+ * @param server   The server.
+ * @param delay_ms Milliseconds from now; the timer fires on the first loop pass after it.
+ * @param callback Called once, on the loop thread.
+ * @param ctx      Passed to the callback.
+ * @return The timer's id (positive), or 0 if LOOP_MAX_TIMERS are pending.
+ */
+long cx_loop_add_timer(struct Server *server, long delay_ms, LoopTimerCallback callback, void *ctx);
+
+
+/**
+ * @brief Cancels a pending timer.
+ *
+ * @param server The server.
+ * @param id     The id returned by cx_loop_add_timer().
+ * @return 1 on success, 0 if the timer already fired or does not exist.
+ */
+int cx_loop_cancel_timer(struct Server *server, long id);
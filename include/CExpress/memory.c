@@ -0,0 +1,177 @@
+/**
+ * @file memory.c
+ * @brief Implementation of the page-level memory options.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-22
+ */
+
+#include "memory.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+
+static MemoryOptions memory_options = { HUGE_PAGES_NONE, 0, 0 };
+
+
+/**
+ * @brief Sets the process-wide memory options.
+ */
+void cx_set_memory_options(const MemoryOptions *options) {
+    if (options) {
+        memory_options = *options;
+    }
+}
+
+
+/**
+ * @brief Returns the process-wide memory options.
+ */
+const MemoryOptions *cx_get_memory_options(void) {
+    return &memory_options;
+}
+
+
+/**
+ * @brief Tells whether mapped memory must stay resident (prefaulted or locked).
+ */
+int memory_pinned(void) {
+    return memory_options.prefault || memory_options.lock_memory;
+}
+
+
+/**
+ * @brief Rounds a size up to the huge page size when huge pages are in use.
+ */
+static size_t memory_round(size_t size) {
+    if (memory_options.huge_pages == HUGE_PAGES_NONE) {
+        return size;
+    }
+    return (size + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1);
+}
+
+
+/**
+ * @brief Maps anonymous memory honoring the memory options.
+ *
+ * Explicit huge pages are tried first and fall back (once, with a warning) to
+ * regular pages when no hugepages are reserved. Otherwise the mapping is
+ * over-sized and trimmed to the requested alignment; with transparent huge
+ * pages the alignment is raised to HUGE_PAGE_SIZE so the kernel can back it.
+ *
+ * @return The zeroed mapping, or NULL on failure.
+ */
+void *memory_map(size_t size, size_t align) {
+    static int hugetlb_failed = 0; // warn once, then stop trying
+    int populate = 0;
+#ifdef MAP_POPULATE
+    populate = memory_options.prefault ? MAP_POPULATE : 0;
+#endif
+    size = memory_round(size);
+
+#ifdef MAP_HUGETLB
+    if (memory_options.huge_pages == HUGE_PAGES_EXPLICIT && !hugetlb_failed && align <= HUGE_PAGE_SIZE) {
+        void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+        if (ptr != MAP_FAILED) {
+            return ptr; // hugetlb mappings are naturally huge-page aligned
+        }
+        perror("mmap(MAP_HUGETLB) failed. Falling back to regular pages");
+        hugetlb_failed = 1;
+    }
+#endif
+
+    if (memory_options.huge_pages != HUGE_PAGES_NONE && align < HUGE_PAGE_SIZE) {
+        align = HUGE_PAGE_SIZE;
+    }
+
+    // Over-map, then trim, to get an aligned mapping.
+    size_t span = size + align;
+    char *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        perror("mmap failed");
+        return NULL;
+    }
+    uintptr_t aligned = ((uintptr_t)raw + align - 1) & ~((uintptr_t)align - 1);
+    size_t head = aligned - (uintptr_t)raw;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    if (span - head - size > 0) {
+        munmap((char *)aligned + size, span - head - size);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (memory_options.huge_pages != HUGE_PAGES_NONE) {
+        madvise((void *)aligned, size, MADV_HUGEPAGE);
+    }
+#endif
+    if (populate || memory_options.prefault) {
+        // Touch every page now (after the huge page advice) instead of on first use.
+        long page = sysconf(_SC_PAGESIZE);
+        for (size_t off = 0; off < size; off += page) {
+            ((volatile char *)aligned)[off] = 0;
+        }
+    }
+    return (void *)aligned;
+}
+
+
+/**
+ * @brief Unmaps memory obtained from memory_map().
+ */
+void memory_unmap(void *ptr, size_t size) {
+    if (ptr) {
+        munmap(ptr, memory_round(size));
+    }
+}
+
+
+/**
+ * @brief Reads a "Key:   value kB" line from /proc/self/status.
+ *
+ * @return The value in kB, or -1 if unavailable.
+ */
+static long status_kb(const char *key) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (!fp) {
+        return -1;
+    }
+    char line[256];
+    long value = -1;
+    size_t key_len = strlen(key);
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+            value = strtol(line + key_len + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(fp);
+    return value;
+}
+
+
+/**
+ * @brief Applies mlockall() if requested and prints how much memory is resident and pinned.
+ *
+ * @return 1 on success, 0 if locking was requested and failed.
+ */
+int memory_lock_and_report(void) {
+    int ok = 1;
+    if (memory_options.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+        perror("mlockall failed. Memory not pinned");
+        ok = 0;
+    }
+
+    const char *huge = memory_options.huge_pages == HUGE_PAGES_EXPLICIT    ? "explicit"
+                     : memory_options.huge_pages == HUGE_PAGES_TRANSPARENT ? "transparent"
+                                                                           : "off";
+    fprintf(stderr, "Memory: huge pages %s, prefault %s, mlockall %s. "
+                    "Resident %ld kB, pinned %ld kB, hugetlb %ld kB.\n",
+            huge, memory_options.prefault ? "on" : "off",
+            memory_options.lock_memory ? (ok ? "on" : "failed") : "off",
+            status_kb("VmRSS"), status_kb("VmLck"), status_kb("HugetlbPages"));
+    return ok;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file memory.h
+ * @brief Page-level memory options for the framework's pools and regions.
+ *
+ * Latency-critical deployments can back the slab pool and the static budget
+ * region with transparent or explicit (hugetlbfs) huge pages, prefault them
+ * when they are mapped, and pin the whole process with mlockall(). The options
+ * are process-wide and must be set before servers are initialized.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-22
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+// User defined constants
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) // huge page size assumed for alignment
+
+
+/**
+ * @enum huge_pages_t
+ * @brief Huge page backing of framework memory.
+ * - HUGE_PAGES_NONE        : Regular pages.
+ * - HUGE_PAGES_TRANSPARENT : 2 MiB-aligned mappings advised with MADV_HUGEPAGE.
+ * - HUGE_PAGES_EXPLICIT    : MAP_HUGETLB mappings (needs reserved hugepages, falls back to regular pages).
+ */
+typedef enum { HUGE_PAGES_NONE, HUGE_PAGES_TRANSPARENT, HUGE_PAGES_EXPLICIT } huge_pages_t;
+
+
+/**
+ * @struct MemoryOptions
+ * @brief Process-wide page-level options.
+ */
+typedef struct {
+    huge_pages_t huge_pages;  // huge page backing of pool slabs and budget regions
+    int prefault;             // populate mappings when they are created (MAP_POPULATE) and warm the pool at startup
+    int lock_memory;          // mlockall(MCL_CURRENT | MCL_FUTURE) when a server starts
+} MemoryOptions;
+
+
+/**
+ * @brief Sets the process-wide memory options.
+ *
+ * Only mappings created afterwards are affected, so call this before server_init().
+ *
+ * @param options The options to apply.
+ */
+void cx_set_memory_options(const MemoryOptions *options);
+
+
+/**
+ * @brief Returns the process-wide memory options.
+ *
+ * @return Pointer to the current options (never NULL).
+ */
+const MemoryOptions *cx_get_memory_options(void);
+
+
+/**
+ * @brief Maps anonymous memory honoring the memory options.
+ *
+ * @param size  Number of bytes (a multiple of the page size).
+ * @param align Required alignment (a power of two, at least the page size).
+ * @return The zeroed mapping, or NULL on failure. Release it with memory_unmap().
+ */
+void *memory_map(size_t size, size_t align);
+
+
+/**
+ * @brief Unmaps memory obtained from memory_map().
+ *
+ * @param ptr  The mapping.
+ * @param size The size passed to memory_map().
+ */
+void memory_unmap(void *ptr, size_t size);
+
+
+/**
+ * @brief Tells whether mapped memory must stay resident (prefaulted or locked).
+ *
+ * @return 1 if memory must not be handed back to the OS, 0 otherwise.
+ */
+int memory_pinned(void);
+
+
+/**
+ * @brief Applies mlockall() if requested and prints how much memory is resident and pinned.
+ *
+ * @return 1 on success, 0 if locking was requested and failed.
+ */
+int memory_lock_and_report(void);
@@ -0,0 +1,96 @@
+/**
+ * @file notify.c
+ * @brief Implementation of wakeup descriptors (eventfd, or a pipe outside Linux).
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#include "notify.h"
+#include "utils.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+
+/**
+ * @brief Opens a wakeup descriptor.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+int notify_open(Notify *notify) {
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        perror("eventfd failed.");
+        notify->read_fd = notify->write_fd = -1;
+        return 0;
+    }
+    notify->read_fd = notify->write_fd = fd;
+    return 1;
+#else
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("pipe failed.");
+        notify->read_fd = notify->write_fd = -1;
+        return 0;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    notify->read_fd = fds[0];
+    notify->write_fd = fds[1];
+    return 1;
+#endif
+}
+
+
+/**
+ * @brief Wakes the loop watching a descriptor.
+ */
+void notify_signal(const Notify *notify) {
+    if (notify->write_fd == -1) {
+        return;
+    }
+    int saved_errno = errno; // may run in a signal handler
+#ifdef __linux__
+    uint64_t one = 1;
+    write(notify->write_fd, &one, sizeof(one));
+#else
+    char byte = 1;
+    write(notify->write_fd, &byte, 1); // a full pipe already wakes the loop
+#endif
+    errno = saved_errno;
+}
+
+
+/**
+ * @brief Consumes pending wakeups.
+ */
+void notify_drain(const Notify *notify) {
+#ifdef __linux__
+    uint64_t count;
+    read(notify->read_fd, &count, sizeof(count)); // resets the counter
+#else
+    char buf[64];
+    while (read(notify->read_fd, buf, sizeof(buf)) > 0);
+#endif
+}
+
+
+/**
+ * @brief Closes a wakeup descriptor.
+ */
+void notify_close(Notify *notify) {
+    if (notify->read_fd != -1) {
+        close(notify->read_fd);
+    }
+    if (notify->write_fd != -1 && notify->write_fd != notify->read_fd) {
+        close(notify->write_fd);
+    }
+    notify->read_fd = notify->write_fd = -1;
+}
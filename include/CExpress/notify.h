@@ -0,0 +1,56 @@
+/**
+ * @file notify.h
+ * @brief Wakeup descriptors that make a select() loop return from another thread.
+ *
+ * On Linux a Notify is one eventfd: a counter the kernel keeps, so any number
+ * of wakeups costs one descriptor and one read. Elsewhere it falls back to a
+ * non-blocking pipe. Either way notify_signal() is async-signal-safe.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#pragma once
+
+
+/**
+ * @struct Notify
+ * @brief A wakeup descriptor pair; both ends are the same eventfd on Linux.
+ */
+typedef struct {
+    int read_fd;              // watched by the loop, -1 when closed
+    int write_fd;             // written to wake the loop
+} Notify;
+
+
+/**
+ * @brief Opens a wakeup descriptor (non-blocking, close-on-exec).
+ *
+ * @param notify The descriptor to open.
+ * @return 1 on success, 0 on failure (both ends are then -1).
+ */
+int notify_open(Notify *notify);
+
+
+/**
+ * @brief Wakes the loop watching a descriptor. Async-signal-safe.
+ *
+ * @param notify The descriptor; nothing happens if it is closed.
+ */
+void notify_signal(const Notify *notify);
+
+
+/**
+ * @brief Consumes pending wakeups once the loop has seen them.
+ *
+ * @param notify The descriptor.
+ */
+void notify_drain(const Notify *notify);
+
+
+/**
+ * @brief Closes a wakeup descriptor.
+ *
+ * @param notify The descriptor.
+ */
+void notify_close(Notify *notify);
@@ -0,0 +1,322 @@
+/**
+ * @file output.c
+ * @brief Implementation of per-connection output buffering.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#include "output.h"
+#include "alloc.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+
+/**
+ * @brief Initializes an empty output.
+ */
+void output_init(Output *out, size_t limit) {
+    out->data = NULL;
+    out->len = 0;
+    out->sent = 0;
+    out->capacity = 0;
+    out->limit = limit;
+    out->overflow = 0;
+    out->body = NULL;
+    out->body_len = 0;
+    out->body_sent = 0;
+    out->release = NULL;
+    out->file_fd = -1;
+    out->file_offset = 0;
+    out->file_end = 0;
+}
+
+
+/**
+ * @brief Tells whether an output holds bytes not yet written to its socket.
+ */
+int output_pending(const Output *out) {
+    return out && (out->sent < out->len || out->body || out->file_fd != -1);
+}
+
+
+/**
+ * @brief Appends bytes to the buffer, within its limit.
+ *
+ * @return 1 on success, 0 if the bytes do not fit or memory ran out.
+ */
+static int output_append(Output *out, const char *buf, size_t len) {
+    if (out->len - out->sent + len > out->limit) {
+        return 0;
+    }
+    if (out->sent > 0) {
+        // Drop what was already written before growing.
+        memmove(out->data, out->data + out->sent, out->len - out->sent);
+        out->len -= out->sent;
+        out->sent = 0;
+    }
+    if (out->len + len > out->capacity) {
+        size_t capacity = out->capacity ? out->capacity : OUTPUT_MIN_CAPACITY;
+        while (capacity < out->len + len) {
+            capacity *= 2;
+        }
+        char *data = cx_realloc(MEM_SERVER, out->data, out->capacity, capacity);
+        if (!data) {
+            return 0;
+        }
+        out->data = data;
+        out->capacity = capacity;
+    }
+    memcpy(out->data + out->len, buf, len);
+    out->len += len;
+    return 1;
+}
+
+
+/**
+ * @brief Writes bytes to a socket, buffering what it does not accept right away.
+ *
+ * @return `len` on success, -1 on error or overflow.
+ */
+ssize_t output_write(Output *out, int sock, const void *buf, size_t len) {
+    if (!out) {
+        return write_all(sock, buf, len);
+    }
+    if (out->body || out->file_fd != -1) {
+        return -1; // it would overtake the rest of the body
+    }
+
+    const char *p = buf;
+    size_t left = len;
+    while (left > 0 && !output_pending(out)) {
+        ssize_t n = send(sock, p, left, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            if (out->limit > 0) {
+                break; // socket full: buffer the rest
+            }
+            // Nothing may be buffered: give the client a moment to catch up.
+            struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+            if (poll(&pfd, 1, OUTPUT_STALL_MS) <= 0) {
+                return -1;
+            }
+            continue;
+        }
+        p += n;
+        left -= n;
+    }
+    if (left > 0 && !output_append(out, p, left)) {
+        out->overflow = 1;
+        return -1;
+    }
+    return (ssize_t)len;
+}
+
+
+/**
+ * @brief Writes bytes from memory until done or the socket is full.
+ *
+ * @return 1 once all bytes are sent, 0 if the socket is full, -1 on error.
+ */
+static int send_part(int sock, const char *buf, size_t *sent, size_t len, size_t *flushed) {
+    while (*sent < len) {
+        ssize_t n = send(sock, buf + *sent, len - *sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        *sent += n;
+        *flushed += n;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Sends a file with sendfile() until done or the socket is full.
+ *
+ * @return 1 once the file is sent up to `end`, 0 if the socket is full, -1 on error.
+ */
+static int send_file_part(int sock, int fd, off_t *offset, size_t end, size_t *flushed) {
+#ifdef __linux__
+    while ((size_t)*offset < end) {
+        ssize_t n = sendfile(sock, fd, offset, end - *offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            perror("sendfile failed");
+            return -1;
+        }
+        if (n == 0) {
+            return -1; // the file is shorter than announced
+        }
+        *flushed += n;
+    }
+    return 1;
+#else
+    (void)sock;
+    (void)fd;
+    (void)offset;
+    (void)end;
+    (void)flushed;
+    return -1;
+#endif
+}
+
+
+/**
+ * @brief Releases the buffer of copied bytes.
+ */
+static void output_free_data(Output *out) {
+    cx_free(MEM_SERVER, out->data, out->capacity);
+    out->data = NULL;
+    out->len = 0;
+    out->sent = 0;
+    out->capacity = 0;
+}
+
+
+/**
+ * @brief Writes as much buffered data as the socket accepts without blocking.
+ *
+ * @return Number of bytes written, or -1 on a socket error.
+ */
+ssize_t output_flush(Output *out, int sock) {
+    size_t flushed = 0;
+    int done = send_part(sock, out->data, &out->sent, out->len, &flushed);
+    if (done == 1) {
+        output_free_data(out); // drained: idle connections hold no buffer
+    }
+    if (done == 1 && out->body) {
+        done = send_part(sock, out->body, &out->body_sent, out->body_len, &flushed);
+        if (done == 1) {
+            out->release(out->body, out->body_len);
+            out->body = NULL;
+        }
+    }
+    if (done == 1 && out->file_fd != -1) {
+        done = send_file_part(sock, out->file_fd, &out->file_offset, out->file_end, &flushed);
+        if (done == 1) {
+            close(out->file_fd);
+            out->file_fd = -1;
+        }
+    }
+    return (done < 0) ? -1 : (ssize_t)flushed;
+}
+
+
+/**
+ * @brief Sends what an output holds right away, as far as it is allowed to.
+ *
+ * An output that may buffer leaves the rest to the event loop. One that may
+ * not (and a plain one) waits for the socket instead, as output_write() does.
+ *
+ * @return 1 on success, -1 on error (the output is then released).
+ */
+static int output_settle(Output *out, int sock) {
+    for (;;) {
+        if (output_flush(out, sock) < 0) {
+            output_free(out);
+            return -1;
+        }
+        if (!output_pending(out) || out->limit > 0) {
+            return 1;
+        }
+        struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+        if (poll(&pfd, 1, OUTPUT_STALL_MS) <= 0) {
+            output_free(out);
+            return -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Sends a response body without copying what the socket does not accept.
+ *
+ * @return 1 on success, -1 on a socket error.
+ */
+int output_send_body(Output *out, int sock, char *body, size_t sent, size_t len, OutputRelease release) {
+    Output plain;
+    if (!out) {
+        output_init(&plain, 0);
+        out = &plain;
+    }
+    if (out->body || out->file_fd != -1) {
+        release(body, len);
+        return -1;
+    }
+    out->body = body;
+    out->body_len = len;
+    out->body_sent = sent;
+    out->release = release;
+    return output_settle(out, sock);
+}
+
+
+/**
+ * @brief Sends the first `len` bytes of a file with sendfile() (Linux).
+ *
+ * @return 1 on success, -1 on error.
+ */
+int output_send_file(Output *out, int sock, int fd, size_t len) {
+    Output plain;
+    if (!out) {
+        output_init(&plain, 0);
+        out = &plain;
+    }
+    if (out->body || out->file_fd != -1) {
+        return -1;
+    }
+    off_t offset = 0;
+    size_t flushed = 0;
+    if (out->sent == out->len) {
+        // Nothing queued: send straight from the caller's descriptor.
+        int done = send_file_part(sock, fd, &offset, len, &flushed);
+        if (done != 0) {
+            return done;
+        }
+    }
+    out->file_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0); // the cache may close its own while this one is sent
+    if (out->file_fd == -1) {
+        perror("dup failed");
+        return -1;
+    }
+    out->file_offset = offset;
+    out->file_end = len;
+    return output_settle(out, sock);
+}
+
+
+/**
+ * @brief Releases the buffer, body and file of an output, discarding unsent bytes.
+ */
+void output_free(Output *out) {
+    output_free_data(out);
+    if (out->body) {
+        out->release(out->body, out->body_len);
+        out->body = NULL;
+    }
+    if (out->file_fd != -1) {
+        close(out->file_fd);
+        out->file_fd = -1;
+    }
+}
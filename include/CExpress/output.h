@@ -0,0 +1,148 @@
+/**
+ * @file output.h
+ * @brief Per-connection output buffering for non-blocking client sockets.
+ *
+ * Responses are written straight to the socket while the kernel accepts them.
+ * Whatever a slow client leaves unread is copied into the connection's Output
+ * and flushed by the event loop once the socket is writable again, so a slow
+ * reader no longer stalls every other connection. The buffer is capped: a
+ * response that does not fit fails and the connection is dropped.
+ *
+ * Response bodies are not copied at all: output_send_body() keeps the body
+ * itself and output_send_file() a file and an offset, and the loop resumes
+ * sending from them. Only copied bytes count against the cap.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+
+
+// User defined constants
+#define OUTPUT_MIN_CAPACITY 4096   // first allocation of a connection's output buffer
+#define OUTPUT_STALL_MS 1000       // unbuffered outputs wait at most this long for a stalled socket
+
+
+/**
+ * @typedef OutputRelease
+ * @brief Frees a body handed to output_send_body() once it has been sent.
+ *
+ * @param body The body.
+ * @param size Its length.
+ */
+typedef void (*OutputRelease)(char *body, size_t size);
+
+
+/**
+ * @struct Output
+ * @brief Bytes of a connection's responses the client has not read yet.
+ */
+typedef struct {
+    char *data;               // buffered bytes, NULL while nothing is buffered
+    size_t len;               // bytes in `data`
+    size_t sent;              // bytes of `data` already written to the socket
+    size_t capacity;          // size of `data`
+    size_t limit;             // most bytes that may be buffered, 0 to wait for the socket instead
+    int overflow;             // 1 once a response did not fit within `limit`
+    char *body;               // body sent after `data` without a copy, NULL if none
+    size_t body_len;          // bytes in `body`
+    size_t body_sent;         // bytes of `body` already written to the socket
+    OutputRelease release;    // frees `body` once it has been sent
+    int file_fd;              // file sent after `data` with sendfile() (a dup), -1 if none
+    off_t file_offset;        // next byte of `file_fd` to send
+    size_t file_end;          // offset `file_fd` is sent up to
+} Output;
+
+
+/**
+ * @brief Initializes an empty output.
+ *
+ * @param out   The output.
+ * @param limit Most bytes that may be buffered. With 0 nothing is buffered:
+ *              writes wait up to OUTPUT_STALL_MS for the socket instead.
+ */
+void output_init(Output *out, size_t limit);
+
+
+/**
+ * @brief Tells whether an output holds bytes not yet written to its socket.
+ *
+ * @param out The output, or NULL.
+ * @return 1 if bytes are waiting, 0 otherwise.
+ */
+int output_pending(const Output *out);
+
+
+/**
+ * @brief Writes bytes to a socket, buffering what it does not accept right away.
+ *
+ * Bytes go behind any already buffered ones, so responses keep their order.
+ *
+ * @param out  The connection's output, or NULL for a plain blocking write.
+ * @param sock The client socket.
+ * @param buf  The bytes.
+ * @param len  Number of bytes.
+ * @return `len` on success (written or buffered), -1 on a socket error, when
+ *         the bytes do not fit in the buffer (`overflow` is then set) or when a
+ *         body or file is still being sent.
+ */
+ssize_t output_write(Output *out, int sock, const void *buf, size_t len);
+
+
+/**
+ * @brief Sends a response body without copying what the socket does not accept.
+ *
+ * The output takes ownership of `body`: the unsent rest is written from it
+ * as the socket drains, and `release` frees it afterwards (also on failure).
+ * Nothing else may be written to the output until it is sent.
+ *
+ * @param out     The connection's output, or NULL for a plain blocking write.
+ * @param sock    The client socket.
+ * @param body    The body.
+ * @param sent    Bytes of the body the caller already wrote to the socket.
+ * @param len     Length of the body.
+ * @param release Frees the body.
+ * @return 1 on success (sent or under way), -1 on a socket error.
+ */
+int output_send_body(Output *out, int sock, char *body, size_t sent, size_t len, OutputRelease release);
+
+
+/**
+ * @brief Sends the first `len` bytes of a file with sendfile() (Linux).
+ *
+ * What the socket does not accept right away is sent from the file later: the
+ * output keeps a duplicate of `fd` and an offset, never a copy of the bytes.
+ * Nothing else may be written to the output until it is sent.
+ *
+ * @param out  The connection's output, or NULL for a plain blocking send.
+ * @param sock The client socket.
+ * @param fd   The file, which the caller may close afterwards.
+ * @param len  Number of bytes to send.
+ * @return 1 on success (sent or under way), -1 on error.
+ */
+int output_send_file(Output *out, int sock, int fd, size_t len);
+
+
+/**
+ * @brief Writes as much buffered data as the socket accepts without blocking.
+ *
+ * Buffered bytes go first, then the body or file under way. Each is released
+ * once it has been drained.
+ *
+ * @param out  The output.
+ * @param sock The client socket.
+ * @return Number of bytes written, or -1 on a socket error.
+ */
+ssize_t output_flush(Output *out, int sock);
+
+
+/**
+ * @brief Releases the buffer, body and file of an output, discarding unsent bytes.
+ *
+ * @param out The output.
+ */
+void output_free(Output *out);
@@ -0,0 +1,423 @@
+/**
+ * @file pool.c
+ * @brief Implementation of the size-classed slab pool.
+ *
+ * Slabs are POOL_SLAB_SIZE-aligned, so the slab owning a block is found by
+ * masking the block's address. The slab header sits in the slab's first bytes
+ * and blocks follow it. Free blocks are chained through their first word;
+ * blocks never handed out since the slab was (re)initialized are taken from a
+ * bump index instead, which lets a purged slab start over without touching
+ * its (now zeroed) pages.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-18
+ */
+
+#include "pool.h"
+#include "memory.h"
+#include "alloc.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+
+/**
+ * @struct PoolSlab
+ * @brief Header of a slab, stored at the start of the slab itself.
+ */
+typedef struct PoolSlab {
+    struct PoolSlab *next;    // next slab of the same class
+    size_t block_size;        // bytes per block
+    size_t capacity;          // number of blocks in the slab
+    size_t bump;              // index of the first never-used block
+    size_t free_count;        // blocks available (free list + untouched)
+    void *free_list;          // returned blocks
+    long long idle_since;     // now_ms() when the slab became fully free, 0 while used
+    int purged;               // 1 while its pages are returned to the OS
+} PoolSlab;
+
+
+/**
+ * @struct PoolClass
+ * @brief Central (shared) state of a size class.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    PoolSlab *slabs;
+    size_t slab_count;
+} PoolClass;
+
+
+/**
+ * @struct Magazine
+ * @brief Per-thread cache of free blocks, one stack per class.
+ */
+typedef struct {
+    void *blocks[POOL_CLASS_COUNT][POOL_MAGAZINE_SIZE];
+    int count[POOL_CLASS_COUNT];
+    int registered;           // 1 once the thread-exit flush is registered
+} Magazine;
+
+
+static PoolClass classes[POOL_CLASS_COUNT] = {
+    [0 ... POOL_CLASS_COUNT - 1] = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+};
+static _Thread_local Magazine magazine;
+static pthread_key_t magazine_key;
+static pthread_once_t magazine_key_once = PTHREAD_ONCE_INIT;
+
+static atomic_size_t blocks_in_use[POOL_CLASS_COUNT];
+static atomic_size_t blocks_cached[POOL_CLASS_COUNT];
+static atomic_size_t large_allocs;
+
+
+/**
+ * @brief Returns the class index serving `size`, or -1 for large allocations.
+ */
+static int pool_class(size_t size) {
+    if (size > POOL_MAX_BLOCK) {
+        return -1;
+    }
+    int index = 0;
+    while (((size_t)1 << (POOL_MIN_SHIFT + index)) < size) {
+        index++;
+    }
+    return index;
+}
+
+
+/**
+ * @brief Returns how many free blocks a thread may cache for a class.
+ *
+ * Bounded by both POOL_MAGAZINE_SIZE and POOL_MAGAZINE_BYTES so large classes
+ * do not strand megabytes in idle threads.
+ */
+static int magazine_limit(int index) {
+    size_t limit = POOL_MAGAZINE_BYTES >> (POOL_MIN_SHIFT + index);
+    if (limit > POOL_MAGAZINE_SIZE) limit = POOL_MAGAZINE_SIZE;
+    if (limit < 2) limit = 2;
+    return (int)limit;
+}
+
+
+/**
+ * @brief Returns the offset of the first block in a slab of a given block size.
+ */
+static size_t slab_data_offset(size_t block_size) {
+    size_t header = sizeof(PoolSlab);
+    // Small blocks only need max_align_t alignment; larger ones start on a block boundary.
+    size_t align = (block_size < 4096) ? sizeof(max_align_t) : block_size;
+    return (header + align - 1) & ~(align - 1);
+}
+
+
+/**
+ * @brief Initializes a slab header for a class and links it into the class list.
+ *        Called with the class lock held.
+ */
+static void slab_init(PoolSlab *slab, int index) {
+    slab->block_size = (size_t)1 << (POOL_MIN_SHIFT + index);
+    slab->capacity = (POOL_SLAB_SIZE - slab_data_offset(slab->block_size)) / slab->block_size;
+    slab->bump = 0;
+    slab->free_count = slab->capacity;
+    slab->free_list = NULL;
+    slab->idle_since = 0;
+    slab->purged = 0;
+
+    slab->next = classes[index].slabs;
+    classes[index].slabs = slab;
+    classes[index].slab_count++;
+}
+
+
+/**
+ * @brief Maps new POOL_SLAB_SIZE-aligned slabs for a class. Called with the class lock held.
+ *
+ * With huge pages a whole huge page worth of slabs is mapped at once, so every
+ * huge page is fully owned by one class.
+ *
+ * @return One of the new slabs, or NULL on failure.
+ */
+static PoolSlab *slab_create(int index) {
+    size_t group = POOL_SLAB_SIZE;
+    if (cx_get_memory_options()->huge_pages != HUGE_PAGES_NONE && group < HUGE_PAGE_SIZE) {
+        group = HUGE_PAGE_SIZE;
+    }
+
+    char *base = memory_map(group, POOL_SLAB_SIZE);
+    if (!base) {
+        perror("memory_map failed. Pool slab not created.");
+        return NULL;
+    }
+    for (size_t off = 0; off < group; off += POOL_SLAB_SIZE) {
+        slab_init((PoolSlab *)(base + off), index);
+    }
+    return classes[index].slabs;
+}
+
+
+/**
+ * @brief Takes one block out of a slab. Called with the class lock held.
+ */
+static void *slab_take(PoolSlab *slab) {
+    void *block;
+    if (slab->free_list) {
+        block = slab->free_list;
+        slab->free_list = *(void **)block;
+    } else {
+        block = (char *)slab + slab_data_offset(slab->block_size) + slab->bump * slab->block_size;
+        slab->bump++;
+    }
+    slab->free_count--;
+    slab->idle_since = 0;
+    slab->purged = 0;
+    return block;
+}
+
+
+/**
+ * @brief Moves up to `n` blocks of a class from the central slabs into `out`.
+ *
+ * @return The number of blocks provided.
+ */
+static int central_take(int index, void **out, int n) {
+    PoolClass *cls = &classes[index];
+    int got = 0;
+
+    pthread_mutex_lock(&cls->lock);
+    for (PoolSlab *slab = cls->slabs; slab && got < n; slab = slab->next) {
+        while (slab->free_count > 0 && got < n) {
+            out[got++] = slab_take(slab);
+        }
+    }
+    while (got < n) {
+        PoolSlab *slab = slab_create(index);
+        if (!slab) break;
+        while (slab->free_count > 0 && got < n) {
+            out[got++] = slab_take(slab);
+        }
+    }
+    pthread_mutex_unlock(&cls->lock);
+    return got;
+}
+
+
+/**
+ * @brief Returns `n` blocks of a class to their slabs.
+ */
+static void central_give(int index, void **blocks, int n) {
+    PoolClass *cls = &classes[index];
+    long long now = now_ms();
+
+    pthread_mutex_lock(&cls->lock);
+    for (int i = 0; i < n; i++) {
+        PoolSlab *slab = (PoolSlab *)((uintptr_t)blocks[i] & ~((uintptr_t)POOL_SLAB_SIZE - 1));
+        *(void **)blocks[i] = slab->free_list;
+        slab->free_list = blocks[i];
+        slab->free_count++;
+        if (slab->free_count == slab->capacity) {
+            slab->idle_since = now;
+        }
+    }
+    pthread_mutex_unlock(&cls->lock);
+}
+
+
+/**
+ * @brief Thread-exit destructor: hands the thread's cached blocks back to the slabs.
+ */
+static void magazine_flush(void *unused) {
+    (void)unused;
+    for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+        if (magazine.count[i] > 0) {
+            central_give(i, magazine.blocks[i], magazine.count[i]);
+            atomic_fetch_sub_explicit(&blocks_cached[i], magazine.count[i], memory_order_relaxed);
+            magazine.count[i] = 0;
+        }
+    }
+}
+
+
+static void magazine_key_create(void) {
+    pthread_key_create(&magazine_key, magazine_flush);
+}
+
+
+/**
+ * @brief Registers the calling thread's magazine for flushing at thread exit.
+ */
+static void magazine_register(void) {
+    pthread_once(&magazine_key_once, magazine_key_create);
+    pthread_setspecific(magazine_key, &magazine); // non-NULL value makes the destructor run
+    magazine.registered = 1;
+}
+
+
+/**
+ * @brief Allocates a buffer of at least `size` bytes from the calling thread's magazine,
+ *        refilling it from the central slabs when empty.
+ */
+void *pool_alloc(size_t size) {
+    int index = pool_class(size);
+    if (index < 0) {
+        void *ptr = cx_malloc(MEM_POOL, size);
+        if (ptr) atomic_fetch_add_explicit(&large_allocs, 1, memory_order_relaxed);
+        return ptr;
+    }
+
+    if (!magazine.registered) {
+        magazine_register();
+    }
+
+    if (magazine.count[index] == 0) {
+        // Refill half a magazine so alternating alloc/free does not bounce on the lock.
+        int got = central_take(index, magazine.blocks[index], magazine_limit(index) / 2);
+        if (got == 0) return NULL;
+        magazine.count[index] = got;
+        atomic_fetch_add_explicit(&blocks_cached[index], got, memory_order_relaxed);
+    }
+
+    void *block = magazine.blocks[index][--magazine.count[index]];
+    atomic_fetch_sub_explicit(&blocks_cached[index], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&blocks_in_use[index], 1, memory_order_relaxed);
+    return block;
+}
+
+
+/**
+ * @brief Returns a buffer to the calling thread's magazine, spilling half of it to the
+ *        central slabs when full.
+ */
+void pool_free(void *ptr, size_t size) {
+    if (!ptr) return;
+
+    int index = pool_class(size);
+    if (index < 0) {
+        cx_free(MEM_POOL, ptr, size);
+        atomic_fetch_sub_explicit(&large_allocs, 1, memory_order_relaxed);
+        return;
+    }
+
+    if (!magazine.registered) {
+        magazine_register();
+    }
+
+    if (magazine.count[index] >= magazine_limit(index)) {
+        int spill = magazine_limit(index) / 2;
+        magazine.count[index] -= spill;
+        central_give(index, &magazine.blocks[index][magazine.count[index]], spill);
+        atomic_fetch_sub_explicit(&blocks_cached[index], spill, memory_order_relaxed);
+    }
+
+    magazine.blocks[index][magazine.count[index]++] = ptr;
+    atomic_fetch_add_explicit(&blocks_cached[index], 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&blocks_in_use[index], 1, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Returns the usable size of a buffer allocated for `size` bytes.
+ */
+size_t pool_block_size(size_t size) {
+    int index = pool_class(size);
+    return (index < 0) ? size : (size_t)1 << (POOL_MIN_SHIFT + index);
+}
+
+
+/**
+ * @brief Ensures a size class has at least `blocks` free blocks mapped.
+ *
+ * @return The number of free blocks available in the class afterwards.
+ */
+size_t pool_reserve(size_t size, size_t blocks) {
+    int index = pool_class(size);
+    if (index < 0) {
+        return 0;
+    }
+
+    PoolClass *cls = &classes[index];
+    pthread_mutex_lock(&cls->lock);
+    size_t available = 0;
+    for (PoolSlab *slab = cls->slabs; slab; slab = slab->next) {
+        available += slab->free_count;
+    }
+    while (available < blocks) {
+        size_t before = cls->slab_count;
+        if (!slab_create(index)) {
+            break;
+        }
+        for (PoolSlab *slab = cls->slabs; before < cls->slab_count; slab = slab->next, before++) {
+            available += slab->free_count;
+        }
+    }
+    pthread_mutex_unlock(&cls->lock);
+    return available;
+}
+
+
+/**
+ * @brief Returns slabs that have been fully free for `idle_ms` to the OS.
+ *
+ * Blocks cached in thread magazines keep their slab alive, so the calling
+ * thread's magazines are flushed first.
+ *
+ * @return The number of slabs purged.
+ */
+size_t pool_trim(long long idle_ms) {
+    if (memory_pinned()) {
+        return 0; // prefaulted/locked memory stays resident
+    }
+    magazine_flush(NULL);
+
+    long long now = now_ms();
+    long page = sysconf(_SC_PAGESIZE);
+    size_t purged = 0;
+
+    for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+        PoolClass *cls = &classes[i];
+        pthread_mutex_lock(&cls->lock);
+        for (PoolSlab *slab = cls->slabs; slab; slab = slab->next) {
+            if (slab->purged || slab->idle_since == 0 || now - slab->idle_since < idle_ms) {
+                continue;
+            }
+            // Keep the header page; everything after it goes back to the OS.
+            if (madvise((char *)slab + page, POOL_SLAB_SIZE - page, MADV_DONTNEED) == 0) {
+                slab->free_list = NULL;
+                slab->bump = 0;
+                slab->purged = 1;
+                purged++;
+            }
+        }
+        pthread_mutex_unlock(&cls->lock);
+    }
+    return purged;
+}
+
+
+/**
+ * @brief Takes a snapshot of the pool's occupancy.
+ */
+void pool_stats(PoolStats *stats) {
+    memset(stats, 0, sizeof(PoolStats));
+    for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+        PoolClassStats *cs = &stats->classes[i];
+        cs->block_size = (size_t)1 << (POOL_MIN_SHIFT + i);
+
+        pthread_mutex_lock(&classes[i].lock);
+        for (PoolSlab *slab = classes[i].slabs; slab; slab = slab->next) {
+            cs->slabs++;
+            cs->blocks_total += slab->capacity;
+            cs->slabs_purged += slab->purged;
+        }
+        pthread_mutex_unlock(&classes[i].lock);
+
+        cs->blocks_in_use = atomic_load_explicit(&blocks_in_use[i], memory_order_relaxed);
+        cs->blocks_cached = atomic_load_explicit(&blocks_cached[i], memory_order_relaxed);
+        stats->bytes_mapped += cs->slabs * POOL_SLAB_SIZE;
+        stats->bytes_in_use += cs->blocks_in_use * cs->block_size;
+    }
+    stats->large_allocs = atomic_load_explicit(&large_allocs, memory_order_relaxed);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file pool.h
+ * @brief Size-classed slab pool for framework I/O buffers.
+ *
+ * Buffers from 1 KB to 64 KB are served from 1 MiB slabs, one slab list per
+ * power-of-two size class. Each thread keeps a small magazine of free blocks per
+ * class so the common alloc/free pair never takes a lock. Slabs that stay fully
+ * free for a while are returned to the OS with madvise() by pool_trim().
+ *
+ * Larger requests fall through to the allocator hooks (see alloc.h).
+ *
+ * Slabs are mapped through memory_map(), so they follow the huge page and
+ * prefault options of memory.h. Pinned memory is never purged.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-18
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+// User defined constants
+#define POOL_MIN_SHIFT 10                    // smallest class is 1 << 10 = 1 KB
+#define POOL_CLASS_COUNT 7                   // 1, 2, 4, 8, 16, 32, 64 KB
+#define POOL_MAX_BLOCK (1 << (POOL_MIN_SHIFT + POOL_CLASS_COUNT - 1))
+#define POOL_SLAB_SIZE (1024 * 1024)         // slab size (and alignment) in bytes
+#define POOL_MAGAZINE_SIZE 32                // max free blocks cached per class and thread
+#define POOL_MAGAZINE_BYTES (256 * 1024)     // max bytes cached per class and thread
+#define POOL_IDLE_MS 30000                   // a fully free slab is purged after this long
+
+
+/**
+ * @struct PoolClassStats
+ * @brief Occupancy of one size class.
+ */
+typedef struct {
+    size_t block_size;        // bytes per block
+    size_t slabs;             // slabs mapped for this class
+    size_t slabs_purged;      // slabs currently returned to the OS
+    size_t blocks_total;      // blocks across all slabs
+    size_t blocks_in_use;     // blocks held by callers
+    size_t blocks_cached;     // free blocks sitting in thread magazines
+} PoolClassStats;
+
+
+/**
+ * @struct PoolStats
+ * @brief Snapshot of the pool's occupancy.
+ */
+typedef struct {
+    PoolClassStats classes[POOL_CLASS_COUNT];
+    size_t bytes_mapped;      // address space reserved by slabs
+    size_t bytes_in_use;      // block bytes held by callers
+    size_t large_allocs;      // live allocations above POOL_MAX_BLOCK (served by malloc)
+} PoolStats;
+
+
+/**
+ * @brief Allocates a buffer of at least `size` bytes.
+ *
+ * @param size Requested size in bytes.
+ * @return The buffer, or NULL on failure. Release it with pool_free() and the same `size`.
+ */
+void *pool_alloc(size_t size);
+
+
+/**
+ * @brief Returns a buffer obtained from pool_alloc().
+ *
+ * @param ptr  The buffer (NULL is ignored).
+ * @param size The size that was passed to pool_alloc().
+ */
+void pool_free(void *ptr, size_t size);
+
+
+/**
+ * @brief Returns the usable size of a buffer allocated for `size` bytes.
+ *
+ * @param size Requested size in bytes.
+ * @return The block size of the matching class, or `size` for large allocations.
+ */
+size_t pool_block_size(size_t size);
+
+
+/**
+ * @brief Ensures a size class has at least `blocks` free blocks mapped.
+ *
+ * Used at startup to map (and, with prefaulting, fault in) the slabs the
+ * server will need, instead of taking page faults on the first requests.
+ *
+ * @param size   A size served by the class.
+ * @param blocks Number of free blocks to have available.
+ * @return The number of free blocks available in the class afterwards.
+ */
+size_t pool_reserve(size_t size, size_t blocks);
+
+
+/**
+ * @brief Returns slabs that have been fully free for `idle_ms` to the OS.
+ *
+ * The address space stays reserved, so purged slabs are reused transparently.
+ * Does nothing while memory is pinned (prefaulted or locked).
+ *
+ * @param idle_ms Minimum idle time in milliseconds before a slab is purged.
+ * @return The number of slabs purged.
+ */
+size_t pool_trim(long long idle_ms);
+
+
+/**
+ * @brief Takes a snapshot of the pool's occupancy.
+ *
+ * @param stats Receives the statistics.
+ */
+void pool_stats(PoolStats *stats);
@@ -0,0 +1,227 @@
+/**
+ * @file pressure.c
+ * @brief Implementation of memory pressure monitoring (PSI and cgroup v2).
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-25
+ */
+
+#include "pressure.h"
+#include "utils.h"
+
+#include <fcntl.h>
+
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+
+
+/**
+ * @brief Reads a small text file into `buf` (NUL-terminated).
+ *
+ * Uses plain descriptors: fopen() would allocate a FILE on every sample,
+ * which static memory budget mode does not allow after startup.
+ *
+ * @return 1 if something was read, 0 otherwise.
+ */
+static int read_text(const char *path, char *buf, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    size_t n = 0;
+    while (n < size - 1) {
+        ssize_t got = read(fd, buf + n, size - 1 - n);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        n += (size_t)got;
+    }
+    close(fd);
+    buf[n] = '\0';
+    return n > 0;
+}
+
+
+/**
+ * @brief Initializes a monitor and locates the process's cgroup v2 directory.
+ */
+void pressure_init(PressureMonitor *monitor) {
+    memset(monitor, 0, sizeof(PressureMonitor));
+
+    // cgroup v2 has a single hierarchy, listed as "0::/path".
+    char buf[512];
+    if (!read_text("/proc/self/cgroup", buf, sizeof(buf))) {
+        return;
+    }
+    char *line = strstr(buf, "0::");
+    if (!line || (line != buf && line[-1] != '\n')) {
+        return;
+    }
+    line += 3;
+    line[strcspn(line, "\n")] = '\0';
+    if (strcmp(line, "/") == 0) {
+        line = "";
+    }
+    snprintf(monitor->cgroup_dir, sizeof(monitor->cgroup_dir), "%s%s", CGROUP_ROOT, line);
+}
+
+
+/**
+ * @brief Reads the "some" and "full" avg10 values from /proc/pressure/memory.
+ */
+static int sample_psi(MemoryPressure *sample) {
+    char buf[256];
+    if (!read_text("/proc/pressure/memory", buf, sizeof(buf))) {
+        return 0;
+    }
+    char *some = strstr(buf, "some avg10=");
+    char *full = strstr(buf, "full avg10=");
+    if (!some) {
+        return 0;
+    }
+    sample->some_avg10 = strtod(some + strlen("some avg10="), NULL);
+    sample->full_avg10 = full ? strtod(full + strlen("full avg10="), NULL) : 0.0;
+    return 1;
+}
+
+
+/**
+ * @brief Finds the cgroup (the process's own or an ancestor) closest to its memory limit.
+ */
+static int sample_cgroup(const PressureMonitor *monitor, MemoryPressure *sample) {
+    if (monitor->cgroup_dir[0] == '\0') {
+        return 0;
+    }
+
+    char dir[sizeof(monitor->cgroup_dir)];
+    snprintf(dir, sizeof(dir), "%s", monitor->cgroup_dir);
+    int found = 0;
+
+    // The walk ends at the mount point: in a container with its own cgroup
+    // namespace that is where the limit lives. The host's root has no memory.max.
+    while (strlen(dir) >= strlen(CGROUP_ROOT)) {
+        char path[sizeof(dir) + 32];
+        char buf[64];
+
+        snprintf(path, sizeof(path), "%s/memory.max", dir);
+        if (read_text(path, buf, sizeof(buf)) && strncmp(buf, "max", 3) != 0) {
+            size_t max = strtoull(buf, NULL, 10);
+            snprintf(path, sizeof(path), "%s/memory.current", dir);
+            if (max > 0 && read_text(path, buf, sizeof(buf))) {
+                size_t current = strtoull(buf, NULL, 10);
+                // Keep the highest usage ratio: current/max > best_current/best_max.
+                if (!found || (double)current / max > (double)sample->cgroup_current / sample->cgroup_max) {
+                    sample->cgroup_current = current;
+                    sample->cgroup_max = max;
+                    found = 1;
+                }
+            }
+        }
+        *strrchr(dir, '/') = '\0';
+    }
+    return found;
+}
+
+
+/**
+ * @brief Reads the current pressure signals.
+ *
+ * @return 1 if at least one signal is available, 0 otherwise.
+ */
+int pressure_sample(const PressureMonitor *monitor, MemoryPressure *sample) {
+    memset(sample, 0, sizeof(MemoryPressure));
+    sample->psi_available = sample_psi(sample);
+    sample->cgroup_available = sample_cgroup(monitor, sample);
+    return sample->psi_available || sample->cgroup_available;
+}
+
+
+/**
+ * @brief Classifies a sample into a pressure level.
+ */
+pressure_level_t pressure_classify(const MemoryPressure *sample) {
+    pressure_level_t level = PRESSURE_NONE;
+
+    if (sample->psi_available) {
+        if (sample->full_avg10 >= PRESSURE_FULL_CRITICAL) {
+            level = PRESSURE_CRITICAL;
+        } else if (sample->some_avg10 >= PRESSURE_SOME_HIGH) {
+            level = PRESSURE_HIGH;
+        } else if (sample->some_avg10 >= PRESSURE_SOME_MODERATE) {
+            level = PRESSURE_MODERATE;
+        }
+    }
+
+    if (sample->cgroup_available) {
+        double usage = 100.0 * sample->cgroup_current / sample->cgroup_max;
+        pressure_level_t cgroup_level = PRESSURE_NONE;
+        if (usage >= PRESSURE_CGROUP_CRITICAL) {
+            cgroup_level = PRESSURE_CRITICAL;
+        } else if (usage >= PRESSURE_CGROUP_HIGH) {
+            cgroup_level = PRESSURE_HIGH;
+        } else if (usage >= PRESSURE_CGROUP_MODERATE) {
+            cgroup_level = PRESSURE_MODERATE;
+        }
+        if (cgroup_level > level) {
+            level = cgroup_level;
+        }
+    }
+    return level;
+}
+
+
+/**
+ * @brief Samples pressure if due and updates the monitor's level.
+ *
+ * @return 1 if the level changed, 0 otherwise.
+ */
+int pressure_update(PressureMonitor *monitor, long long now) {
+    if (now - monitor->last_sample_ms < PRESSURE_SAMPLE_MS) {
+        return 0;
+    }
+    monitor->last_sample_ms = now;
+
+    MemoryPressure sample;
+    if (!pressure_sample(monitor, &sample)) {
+        return 0;
+    }
+    pressure_level_t level = pressure_classify(&sample);
+
+    if (level > monitor->level) {
+        monitor->level = level;
+        monitor->relax_since_ms = 0;
+        return 1;
+    }
+    if (level == monitor->level) {
+        monitor->relax_since_ms = 0;
+        return 0;
+    }
+
+    // Lower pressure: restore one step once it has held long enough.
+    if (monitor->relax_since_ms == 0) {
+        monitor->relax_since_ms = now;
+        return 0;
+    }
+    if (now - monitor->relax_since_ms < PRESSURE_RELAX_MS) {
+        return 0;
+    }
+    monitor->level--;
+    monitor->relax_since_ms = (level < monitor->level) ? now : 0;
+    return 1;
+}
+
+
+/**
+ * @brief Returns the name of a pressure level.
+ */
+const char *pressure_level_name(pressure_level_t level) {
+    switch (level) {
+        case PRESSURE_MODERATE: return "moderate";
+        case PRESSURE_HIGH: return "high";
+        case PRESSURE_CRITICAL: return "critical";
+        default: return "none";
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file pressure.h
+ * @brief Host and cgroup memory pressure monitoring for the CExpress framework.
+ *
+ * The server samples Linux pressure stall information (/proc/pressure/memory)
+ * and the limit and usage of its cgroup v2 memory controller from the event
+ * loop. The resulting pressure level drives how much memory the response cache
+ * may keep and how aggressively pooled buffers are returned to the OS.
+ *
+ * On systems without PSI or cgroup v2 the corresponding signal is simply
+ * unavailable; with neither, the level always stays PRESSURE_NONE.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-25
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+// User defined constants
+#define PRESSURE_SAMPLE_MS 2000        // interval between two pressure samples
+#define PRESSURE_RELAX_MS 30000        // time a lower level must hold before capacity is restored one step
+#define PRESSURE_SOME_MODERATE 10.0    // PSI "some avg10" (%) at which pressure is moderate
+#define PRESSURE_SOME_HIGH 30.0        // PSI "some avg10" (%) at which pressure is high
+#define PRESSURE_FULL_CRITICAL 10.0    // PSI "full avg10" (%) at which pressure is critical
+#define PRESSURE_CGROUP_MODERATE 80    // cgroup usage (% of memory.max) at which pressure is moderate
+#define PRESSURE_CGROUP_HIGH 90        // cgroup usage (% of memory.max) at which pressure is high
+#define PRESSURE_CGROUP_CRITICAL 95    // cgroup usage (% of memory.max) at which pressure is critical
+
+
+/**
+ * @enum pressure_level_t
+ * @brief Memory pressure levels, from none to critical.
+ * - PRESSURE_NONE     : Full cache capacity.
+ * - PRESSURE_MODERATE : Cache limited to half its capacity, all free pool slabs purged.
+ * - PRESSURE_HIGH     : Cache limited to a quarter of its capacity.
+ * - PRESSURE_CRITICAL : Cache emptied and disabled.
+ */
+typedef enum { PRESSURE_NONE, PRESSURE_MODERATE, PRESSURE_HIGH, PRESSURE_CRITICAL } pressure_level_t;
+
+
+/**
+ * @struct MemoryPressure
+ * @brief One sample of the memory pressure signals.
+ */
+typedef struct {
+    int psi_available;        // 1 if /proc/pressure/memory could be read
+    double some_avg10;        // % of time some tasks stalled on memory (10 s average)
+    double full_avg10;        // % of time all tasks stalled on memory (10 s average)
+    int cgroup_available;     // 1 if a cgroup memory limit was found
+    size_t cgroup_current;    // memory.current of the tightest limited cgroup
+    size_t cgroup_max;        // memory.max of the tightest limited cgroup
+} MemoryPressure;
+
+
+/**
+ * @struct PressureMonitor
+ * @brief Pressure state tracked by a server between samples.
+ */
+typedef struct {
+    pressure_level_t level;   // level currently applied
+    long long last_sample_ms; // monotonic time of the last sample
+    long long relax_since_ms; // when samples started reading below `level`, 0 if they do not
+    char cgroup_dir[256];     // cgroup v2 directory of the process, empty if none
+} PressureMonitor;
+
+
+/**
+ * @brief Initializes a monitor and locates the process's cgroup v2 directory.
+ *
+ * @param monitor The monitor to initialize.
+ */
+void pressure_init(PressureMonitor *monitor);
+
+
+/**
+ * @brief Reads the current pressure signals.
+ *
+ * @param monitor The monitor (for the cgroup directory).
+ * @param sample  Receives the signals.
+ * @return 1 if at least one signal is available, 0 otherwise.
+ */
+int pressure_sample(const PressureMonitor *monitor, MemoryPressure *sample);
+
+
+/**
+ * @brief Classifies a sample into a pressure level.
+ *
+ * The level is the highest one reached by either PSI or cgroup usage.
+ *
+ * @param sample The sample.
+ * @return The pressure level.
+ */
+pressure_level_t pressure_classify(const MemoryPressure *sample);
+
+
+/**
+ * @brief Samples pressure if due and updates the monitor's level.
+ *
+ * Rising pressure is applied immediately. Falling pressure must hold for
+ * PRESSURE_RELAX_MS before the level drops, and it drops one step at a time,
+ * so capacity is restored progressively.
+ *
+ * @param monitor The monitor.
+ * @param now     Current monotonic time in milliseconds.
+ * @return 1 if the level changed, 0 otherwise.
+ */
+int pressure_update(PressureMonitor *monitor, long long now);
+
+
+/**
+ * @brief Returns the name of a pressure level (for logging).
+ *
+ * @param level The level.
+ * @return A static string such as "none" or "high".
+ */
+const char *pressure_level_name(pressure_level_t level);
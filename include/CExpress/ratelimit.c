@@ -0,0 +1,348 @@
+/**
+ * @file ratelimit.c
+ * @brief Implementation of per-client connection caps and token-bucket rate limiting.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-27
+ */
+
+#include "ratelimit.h"
+#include "alloc.h"
+#include "utils.h"
+
+#include <unistd.h>
+
+
+#define KEY_IP 1                   // kind of per-IP entries
+#define KEY_PREFIX 2               // kind of per-prefix entries
+
+#define ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND(v0, v1, v2, v3) do {                                   \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32);       \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;                          \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;                          \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32);       \
+    } while (0)
+
+
+/**
+ * @brief SipHash-2-4 of a message of whole 64-bit words.
+ */
+static uint64_t siphash_words(const uint64_t key[2], const uint64_t *m, size_t n) {
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+    uint64_t b = (uint64_t)(n * 8) << 56; // message length in the last block
+
+    for (size_t i = 0; i < n; i++) {
+        v3 ^= m[i];
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m[i];
+    }
+
+    v3 ^= b;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+
+/**
+ * @brief Fills the SipHash key from /dev/urandom (time and pid as a last resort).
+ */
+static void seed_key(uint64_t key[2]) {
+    FILE *urandom = fopen("/dev/urandom", "r");
+    if (urandom) {
+        size_t n = fread(key, sizeof(uint64_t), 2, urandom);
+        fclose(urandom);
+        if (n == 2) {
+            return;
+        }
+    }
+    key[0] = (uint64_t)now_ms() * 0x9E3779B97F4A7C15ULL;
+    key[1] = ((uint64_t)getpid() << 32) ^ (uint64_t)time(NULL);
+}
+
+
+/**
+ * @brief Sets up a rate limiter sized for a number of client slots.
+ *
+ * @return 1 on success, 0 on allocation failure.
+ */
+int ratelimit_init(RateLimiter *limiter, int max_clients, const RateLimits *limits) {
+    memset(limiter, 0, sizeof(RateLimiter));
+    limiter->limits = *limits;
+    if (limiter->limits.requests_per_sec > 0 && limiter->limits.burst < 1) {
+        // No burst given: allow one second worth of requests at once.
+        limiter->limits.burst = limiter->limits.requests_per_sec < 1 ? 1 : limiter->limits.requests_per_sec;
+    }
+
+    size_t wanted = (size_t)max_clients * RATELIMIT_SLOTS_PER_CLIENT;
+    limiter->capacity = RATELIMIT_MIN_SLOTS;
+    while (limiter->capacity < wanted) {
+        limiter->capacity *= 2;
+    }
+    limiter->slots = cx_calloc(MEM_SERVER, limiter->capacity, sizeof(RateEntry));
+    if (!limiter->slots) {
+        perror("cx_calloc failed. Rate limiting disabled.");
+        return 0;
+    }
+    seed_key(limiter->sip_key);
+    return 1;
+}
+
+
+/**
+ * @brief Releases the table of a rate limiter.
+ */
+void ratelimit_free(RateLimiter *limiter) {
+    cx_free(MEM_SERVER, limiter->slots, limiter->capacity * sizeof(RateEntry));
+    limiter->slots = NULL;
+    limiter->capacity = 0;
+    limiter->count = 0;
+}
+
+
+/**
+ * @brief Slot a key hashes to.
+ */
+static size_t home_slot(const RateLimiter *limiter, uint32_t kind, const RateAddr *addr) {
+    uint64_t words[3] = { kind, addr->hi, addr->lo };
+    return siphash_words(limiter->sip_key, words, 3) & (limiter->capacity - 1);
+}
+
+
+/**
+ * @brief Clears the host bits of an address: /24 for IPv4, /64 for IPv6.
+ */
+static RateAddr prefix_of(const RateAddr *addr) {
+    RateAddr prefix = *addr;
+    if (addr->hi == 0 && (addr->lo >> 32) == 0xFFFF) {
+        prefix.lo &= 0xFFFFFFFF00000000ULL | RATELIMIT_PREFIX_MASK; // IPv4-mapped
+    } else {
+        prefix.lo = 0; // a /64 is what one IPv6 host usually gets
+    }
+    return prefix;
+}
+
+
+/**
+ * @brief Finds the entry of a key, or NULL.
+ */
+static RateEntry *find_entry(const RateLimiter *limiter, uint32_t kind, const RateAddr *addr) {
+    size_t mask = limiter->capacity - 1;
+    size_t i = home_slot(limiter, kind, addr);
+    while (limiter->slots[i].kind != 0) {
+        RateEntry *entry = &limiter->slots[i];
+        if (entry->kind == kind && entry->addr.hi == addr->hi && entry->addr.lo == addr->lo) {
+            return entry;
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Removes the entry at `index`, shifting later entries of the probe run back.
+ *
+ * Backward-shift deletion keeps every remaining entry reachable from its home
+ * slot without tombstones.
+ */
+static void remove_at(RateLimiter *limiter, size_t index) {
+    size_t mask = limiter->capacity - 1;
+    size_t hole = index;
+    size_t j = index;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (limiter->slots[j].kind == 0) {
+            break;
+        }
+        size_t home = limiter->slots[j].home;
+        // The entry may move into the hole unless its home lies cyclically in (hole, j].
+        int stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!stays) {
+            limiter->slots[hole] = limiter->slots[j];
+            hole = j;
+        }
+    }
+    memset(&limiter->slots[hole], 0, sizeof(RateEntry));
+    limiter->count--;
+}
+
+
+/**
+ * @brief Brings an entry's token count up to date.
+ */
+static void refill(const RateLimits *limits, RateEntry *entry, long long now) {
+    if (limits->requests_per_sec <= 0) {
+        return;
+    }
+    entry->tokens += (now - entry->refill_ms) * limits->requests_per_sec / 1000.0;
+    if (entry->tokens > limits->burst) {
+        entry->tokens = limits->burst;
+    }
+    entry->refill_ms = now;
+}
+
+
+/**
+ * @brief Drops entries without connections whose bucket has refilled.
+ *
+ * @return The number of entries dropped.
+ */
+size_t ratelimit_sweep(RateLimiter *limiter, long long now) {
+    size_t dropped = 0;
+    for (size_t i = 0; i < limiter->capacity; i++) {
+        RateEntry *entry = &limiter->slots[i];
+        if (entry->kind == 0 || entry->conns > 0) {
+            continue;
+        }
+        refill(&limiter->limits, entry, now);
+        if (limiter->limits.requests_per_sec <= 0 || entry->tokens >= limiter->limits.burst) {
+            remove_at(limiter, i);
+            dropped++;
+            i--; // an entry may have shifted into this slot
+        }
+    }
+    return dropped;
+}
+
+
+/**
+ * @brief Keeps the table at most three quarters full ahead of `needed` insertions.
+ *
+ * Refilled entries are swept first; if that is not enough, entries without
+ * connections are sacrificed.
+ */
+static void make_room(RateLimiter *limiter, size_t needed, long long now) {
+    size_t max_count = limiter->capacity / 4 * 3;
+    if (limiter->count + needed <= max_count) {
+        return;
+    }
+    ratelimit_sweep(limiter, now);
+    for (size_t i = 0; i < limiter->capacity && limiter->count + needed > max_count; i++) {
+        if (limiter->slots[i].kind != 0 && limiter->slots[i].conns == 0) {
+            remove_at(limiter, i);
+            i--;
+        }
+    }
+}
+
+
+/**
+ * @brief Finds the entry of a key, creating it with a full bucket if needed.
+ *
+ * Insertion never moves other entries, so pointers from earlier calls stay valid.
+ *
+ * @return The entry, or NULL if the table has no room (callers then fail open).
+ */
+static RateEntry *get_entry(RateLimiter *limiter, uint32_t kind, const RateAddr *addr, long long now) {
+    RateEntry *entry = find_entry(limiter, kind, addr);
+    if (entry || limiter->count >= limiter->capacity / 4 * 3) {
+        return entry;
+    }
+
+    size_t mask = limiter->capacity - 1;
+    size_t home = home_slot(limiter, kind, addr);
+    size_t i = home;
+    while (limiter->slots[i].kind != 0) {
+        i = (i + 1) & mask;
+    }
+    entry = &limiter->slots[i];
+    entry->addr = *addr;
+    entry->kind = kind;
+    entry->home = (uint32_t)home;
+    entry->conns = 0;
+    entry->tokens = limiter->limits.burst;
+    entry->refill_ms = now;
+    limiter->count++;
+    return entry;
+}
+
+
+/**
+ * @brief Admits a new connection if its IP and prefix are under their caps.
+ *
+ * @return 1 if admitted, 0 if it must be refused.
+ */
+int ratelimit_connect(RateLimiter *limiter, const RateAddr *addr, long long now, int *counted) {
+    const RateLimits *limits = &limiter->limits;
+    *counted = 0;
+    if (limits->max_conns_per_ip <= 0 && limits->max_conns_per_prefix <= 0) {
+        return 1;
+    }
+
+    // Only the keys a cap applies to are tracked.
+    int track_ip = limits->max_conns_per_ip > 0;
+    int track_prefix = limits->max_conns_per_prefix > 0;
+    make_room(limiter, track_ip + track_prefix, now);
+    RateAddr block = prefix_of(addr);
+    RateEntry *ip = track_ip ? get_entry(limiter, KEY_IP, addr, now) : NULL;
+    RateEntry *prefix = track_prefix ? get_entry(limiter, KEY_PREFIX, &block, now) : NULL;
+
+    if ((ip && ip->conns >= (uint32_t)limits->max_conns_per_ip)
+        || (prefix && prefix->conns >= (uint32_t)limits->max_conns_per_prefix)) {
+        limiter->rejected_conns++;
+        return 0;
+    }
+    // Without an entry (full table) the connection is let in uncounted: it must not be uncounted later either.
+    if (ip) {
+        ip->conns++;
+        *counted |= RATELIMIT_COUNTED_IP;
+    }
+    if (prefix) {
+        prefix->conns++;
+        *counted |= RATELIMIT_COUNTED_PREFIX;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Stops counting a connection admitted by ratelimit_connect().
+ */
+void ratelimit_disconnect(RateLimiter *limiter, const RateAddr *addr, int counted) {
+    if (counted & RATELIMIT_COUNTED_IP) {
+        RateEntry *ip = find_entry(limiter, KEY_IP, addr);
+        if (ip && ip->conns > 0) ip->conns--;
+    }
+    if (counted & RATELIMIT_COUNTED_PREFIX) {
+        RateAddr block = prefix_of(addr);
+        RateEntry *prefix = find_entry(limiter, KEY_PREFIX, &block);
+        if (prefix && prefix->conns > 0) prefix->conns--;
+    }
+}
+
+
+/**
+ * @brief Takes a token from the bucket of `addr`.
+ *
+ * @return 1 if the request may proceed, 0 if it must be answered with 429.
+ */
+int ratelimit_request(RateLimiter *limiter, const RateAddr *addr, long long now) {
+    if (limiter->limits.requests_per_sec <= 0) {
+        return 1;
+    }
+    make_room(limiter, 1, now);
+    RateEntry *ip = get_entry(limiter, KEY_IP, addr, now);
+    if (!ip) {
+        return 1;
+    }
+    refill(&limiter->limits, ip, now);
+    if (ip->tokens >= 1) {
+        ip->tokens -= 1;
+        return 1;
+    }
+    limiter->rejected_requests++;
+    return 0;
+}
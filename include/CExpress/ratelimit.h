@@ -0,0 +1,146 @@
+/**
+ * @file ratelimit.h
+ * @brief Per-client connection caps and request rate limiting.
+ *
+ * Connections are capped per client IP and per prefix (/24 for IPv4, /64 for
+ * IPv6, the block a single IPv6 host usually owns) when they are accepted, and
+ * requests are admitted through a token bucket per client IP. IPv4 clients are
+ * keyed by their IPv4-mapped IPv6 address.
+ * State lives in a compact open-addressing table keyed with SipHash-2-4 under a
+ * random per-process key, so clients cannot craft colliding addresses to
+ * degrade lookups. Buckets are refilled lazily from a timestamp when they are
+ * used, so idle clients cost nothing between requests.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-27
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// User defined constants
+#define RATELIMIT_PREFIX_MASK 0xFFFFFF00u  // IPv4 prefix (/24) sharing a connection cap
+#define RATELIMIT_MIN_SLOTS 64             // smallest table size
+#define RATELIMIT_SLOTS_PER_CLIENT 4       // table slots per client slot (keeps the load factor low)
+#define RATELIMIT_COUNTED_IP 1             // the connection is counted against its IP
+#define RATELIMIT_COUNTED_PREFIX 2         // the connection is counted against its prefix
+
+
+/**
+ * @struct RateLimits
+ * @brief Limits applied per client. 0 disables a limit.
+ */
+typedef struct {
+    int max_conns_per_ip;     // concurrent connections from one IP
+    int max_conns_per_prefix; // concurrent connections from one /24 (IPv4) or /64 (IPv6)
+    double requests_per_sec;  // sustained requests per second from one IP
+    double burst;             // requests one IP may send at once (bucket size)
+} RateLimits;
+
+
+/**
+ * @struct RateAddr
+ * @brief Client IPv6 address, IPv4 clients as ::ffff:a.b.c.d.
+ */
+typedef struct {
+    uint64_t hi;              // first 8 bytes (the /64 prefix), host byte order
+    uint64_t lo;              // last 8 bytes, host byte order
+} RateAddr;
+
+
+/**
+ * @struct RateEntry
+ * @brief State of one IP or prefix.
+ */
+typedef struct {
+    RateAddr addr;            // the IP, or the prefix with its host bits cleared
+    uint32_t kind;            // 1 for an IP, 2 for a prefix, 0 for an empty slot
+    uint32_t home;            // slot the key hashes to
+    uint32_t conns;           // open connections
+    double tokens;            // requests available (IP entries)
+    long long refill_ms;      // monotonic time `tokens` was last brought up to date
+} RateEntry;
+
+
+/**
+ * @struct RateLimiter
+ * @brief Open-addressing (linear probing) table of RateEntry.
+ */
+typedef struct {
+    RateLimits limits;
+    RateEntry *slots;
+    size_t capacity;          // power of two
+    size_t count;
+    uint64_t sip_key[2];      // SipHash key, random per process
+    size_t rejected_conns;    // connections refused by a cap
+    size_t rejected_requests; // requests refused by a bucket
+} RateLimiter;
+
+
+/**
+ * @brief Sets up a rate limiter sized for a number of client slots.
+ *
+ * @param limiter     The limiter to initialize.
+ * @param max_clients Number of client slots of the server.
+ * @param limits      The limits to apply.
+ * @return 1 on success, 0 on allocation failure.
+ */
+int ratelimit_init(RateLimiter *limiter, int max_clients, const RateLimits *limits);
+
+
+/**
+ * @brief Releases the table of a rate limiter.
+ *
+ * @param limiter The limiter.
+ */
+void ratelimit_free(RateLimiter *limiter);
+
+
+/**
+ * @brief Admits a new connection from `addr` if its IP and prefix are under their caps.
+ *
+ * When the table is full, a connection whose entries cannot be created is
+ * admitted without being counted against them.
+ *
+ * @param limiter The limiter.
+ * @param addr    Client address.
+ * @param now     Current monotonic time in milliseconds.
+ * @param counted Receives the RATELIMIT_COUNTED_* flags of the entries the
+ *                connection was counted in, to pass to ratelimit_disconnect().
+ * @return 1 if admitted, 0 if it must be refused.
+ */
+int ratelimit_connect(RateLimiter *limiter, const RateAddr *addr, long long now, int *counted);
+
+
+/**
+ * @brief Stops counting a connection admitted by ratelimit_connect().
+ *
+ * @param limiter The limiter.
+ * @param addr    Client address.
+ * @param counted Flags ratelimit_connect() returned for the connection.
+ */
+void ratelimit_disconnect(RateLimiter *limiter, const RateAddr *addr, int counted);
+
+
+/**
+ * @brief Takes a token from the bucket of `addr`.
+ *
+ * @param limiter The limiter.
+ * @param addr    Client address.
+ * @param now     Current monotonic time in milliseconds.
+ * @return 1 if the request may proceed, 0 if it must be answered with 429.
+ */
+int ratelimit_request(RateLimiter *limiter, const RateAddr *addr, long long now);
+
+
+/**
+ * @brief Drops entries without connections whose bucket has refilled.
+ *
+ * @param limiter The limiter.
+ * @param now     Current monotonic time in milliseconds.
+ * @return The number of entries dropped.
+ */
+size_t ratelimit_sweep(RateLimiter *limiter, long long now);
@@ -0,0 +1,60 @@
+/**
+ * @file region.c
+ * @brief Implementation of the up-front memory region.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-20
+ */
+
+#include "region.h"
+#include "memory.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+
+/**
+ * @brief Maps a zeroed region of at least `size` bytes.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+int region_init(Region *region, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size = (size + page - 1) & ~(page - 1);
+
+    void *base = memory_map(size, page);
+    if (!base) {
+        perror("memory_map failed. Memory region not created.");
+        return 0;
+    }
+    region->base = base;
+    region->size = size;
+    region->used = 0;
+    return 1;
+}
+
+
+/**
+ * @brief Carves `size` bytes (aligned for any type) from a region.
+ *
+ * @return Pointer to zeroed memory, or NULL if the region is exhausted.
+ */
+void *region_alloc(Region *region, size_t size) {
+    size_t align = sizeof(max_align_t);
+    size_t offset = (region->used + align - 1) & ~(align - 1);
+    if (!region->base || offset + size > region->size) {
+        return NULL;
+    }
+    region->used = offset + size;
+    return region->base + offset; // anonymous mappings start zeroed
+}
+
+
+/**
+ * @brief Unmaps a region.
+ */
+void region_free(Region region) {
+    if (region.base) {
+        memory_unmap(region.base, region.size);
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * @file region.h
+ * @brief A single up-front memory region carved with a bump pointer.
+ *
+ * Used by the static memory budget mode: every structure a server needs at
+ * runtime is sized and carved from one region at initialization, and nothing
+ * is allocated afterwards. A region is released as a whole.
+ *
+ * Regions are mapped through memory_map() and follow the huge page and
+ * prefault options of memory.h.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-20
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+
+/**
+ * @struct Region
+ * @brief A contiguous mapping handed out front to back.
+ */
+typedef struct {
+    char *base;               // start of the mapping, NULL if the region is not in use
+    size_t size;              // mapping size in bytes
+    size_t used;              // bytes carved so far
+} Region;
+
+
+/**
+ * @brief Maps a zeroed region of at least `size` bytes.
+ *
+ * @param region The region to initialize.
+ * @param size   Requested size in bytes (rounded up to whole pages).
+ * @return 1 on success, 0 on failure.
+ */
+int region_init(Region *region, size_t size);
+
+
+/**
+ * @brief Carves `size` bytes (aligned for any type) from a region.
+ *
+ * @param region The region.
+ * @param size   Number of bytes.
+ * @return Pointer to zeroed memory, or NULL if the region is exhausted.
+ */
+void *region_alloc(Region *region, size_t size);
+
+
+/**
+ * @brief Unmaps a region. Everything carved from it becomes invalid.
+ *
+ * @param region The region (passed by value so it may live inside itself).
+ */
+void region_free(Region region);
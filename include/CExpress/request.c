@@ -0,0 +1,118 @@
+/**
+ * @file request.c
+ * @brief Per-thread current request and handler-facing arena allocation.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-16
+ */
+
+#include "request.h"
+#include "routers.h"
+
+
+static _Thread_local Request *current_request = NULL; // request served by this thread
+
+
+/**
+ * @brief Publishes (or clears) the request served by the calling thread.
+ */
+void request_set_current(Request *req) {
+    current_request = req;
+}
+
+
+/**
+ * @brief Returns the request served by the calling thread.
+ */
+Request *request_current(void) {
+    return current_request;
+}
+
+
+/**
+ * @brief Allocates memory from the current request's arena.
+ *
+ * @return Pointer to the memory, or NULL on failure or outside a handler.
+ */
+void *cx_alloc(size_t size) {
+    if (!current_request || !current_request->arena) {
+        return NULL;
+    }
+    return arena_alloc(current_request->arena, size);
+}
+
+
+/**
+ * @brief Duplicates a string into the current request's arena.
+ *
+ * @return The copy, or NULL on failure or outside a handler.
+ */
+char *cx_strdup(const char *str) {
+    if (!str || !current_request || !current_request->arena) {
+        return NULL;
+    }
+    return arena_strndup(current_request->arena, str, strlen(str));
+}
+
+
+/**
+ * @brief Returns how much of the current request's time budget is left.
+ *
+ * @return Milliseconds left, 0 once the deadline has passed, -1 without a deadline.
+ */
+long cx_request_remaining_ms(void) {
+    if (!current_request || current_request->deadline_us == 0) {
+        return -1;
+    }
+    long long left_us = current_request->deadline_us - now_us();
+    return (left_us > 0) ? (long)(left_us / 1000) : 0;
+}
+
+
+/**
+ * @brief Allocates a response buffer sized to a high percentile of the route's past bodies.
+ *
+ * @return The buffer, or NULL on failure or outside a handler.
+ */
+char *cx_response_buffer(size_t *capacity) {
+    if (!current_request || !current_request->arena) {
+        return NULL;
+    }
+    size_t size = 0;
+    if (current_request->route) {
+        size = size_hist_percentile(&current_request->route->sizes, RESPONSE_SIZE_PERCENTILE);
+    }
+    if (size == 0) {
+        size = RESPONSE_DEFAULT_SIZE;
+    }
+
+    char *buf = arena_alloc(current_request->arena, size);
+    if (buf) {
+        buf[0] = '\0';
+        *capacity = size;
+    }
+    return buf;
+}
+
+
+/**
+ * @brief Grows a response buffer, at least doubling its capacity.
+ *
+ * @return The buffer, or NULL on failure (`buf` stays valid).
+ */
+char *cx_response_grow(char *buf, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return buf;
+    }
+    if (!current_request || !current_request->arena) {
+        return NULL;
+    }
+    size_t size = (*capacity * 2 > needed) ? *capacity * 2 : needed;
+    char *grown = arena_alloc(current_request->arena, size);
+    if (!grown) {
+        return NULL;
+    }
+    memcpy(grown, buf, *capacity);
+    *capacity = size;
+    return grown;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file request.h
+ * @brief Defines the per-request context passed through the request pipeline.
+ *
+ * A Request is filled in by the server when a client's data has been read, then
+ * handed to the router and finally to the handler executor. It carries what the
+ * later stages need without widening every function signature.
+ *
+ * Handlers take no parameters, so the request being served is also published
+ * to the executing thread; cx_alloc() uses it to give handlers memory from the
+ * request's arena.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-14
+ */
+
+#pragma once
+
+#include "utils.h"
+#include "arena.h"
+#include "output.h"
+
+
+// User defined constants
+#define RESPONSE_SIZE_PERCENTILE 95    // share of a route's responses a presized buffer should hold
+#define RESPONSE_DEFAULT_SIZE 1024     // buffer size used until a route has a size history
+
+struct Server;
+struct Router;
+
+
+/**
+ * @struct Request
+ * @brief Context of a single HTTP request being served.
+ */
+typedef struct Request {
+    const char *header;       // raw HTTP request (NUL-terminated)
+    size_t header_len;        // length of the raw request
+    int client_sock;          // socket the response is written to
+    Output *out;              // buffers what a slow client does not read right away (NULL: blocking writes)
+    struct Server *server;    // server that received the request
+    struct Router *route;     // matched route, NULL until routing succeeded
+    Arena *arena;             // per-request memory, reset once the response is sent
+    long long deadline_us;    // monotonic time (us) the client stops waiting, 0 for none
+    int close;                // 1 if the connection is closed after this response (Connection: close)
+} Request;
+
+
+/**
+ * @brief Publishes (or clears) the request served by the calling thread.
+ *
+ * @param req The request about to be handled, or NULL once handling is over.
+ */
+void request_set_current(Request *req);
+
+
+/**
+ * @brief Returns the request served by the calling thread.
+ *
+ * @return The current request, or NULL outside of a handler.
+ */
+Request *request_current(void);
+
+
+/**
+ * @brief Allocates memory that lives until the current response has been sent.
+ *
+ * Intended for handlers: the memory comes from the request's arena, so a handler
+ * may build and return its body with it instead of malloc(). The framework
+ * recognises such bodies and never free()s them.
+ *
+ * @param size Number of bytes to allocate.
+ * @return Pointer to the memory, or NULL on failure or when called outside a handler.
+ */
+void *cx_alloc(size_t size);
+
+
+/**
+ * @brief Duplicates a string into the current request's arena.
+ *
+ * @param str The string to copy.
+ * @return The copy, or NULL on failure or when called outside a handler.
+ */
+char *cx_strdup(const char *str);
+
+
+/**
+ * @brief Returns how much of the current request's time budget is left.
+ *
+ * Handlers doing slow work (calls to other services, long loops) should check
+ * it and give up early: once the budget is spent the framework answers 504
+ * whatever the handler returns.
+ *
+ * @return Milliseconds left (0 once the deadline has passed), or -1 if the
+ *         request has no deadline or when called outside a handler.
+ */
+long cx_request_remaining_ms(void);
+
+
+/**
+ * @brief Allocates a response buffer sized from the route's history.
+ *
+ * The framework records the size of every body a route returns. The buffer is
+ * as large as the RESPONSE_SIZE_PERCENTILE-th percentile of those sizes (including
+ * the terminating NUL), so most responses fit in a single allocation; before a
+ * route has enough history, RESPONSE_DEFAULT_SIZE bytes are used. The buffer
+ * comes from the request's arena, like cx_alloc().
+ *
+ * @param capacity Receives the size of the buffer.
+ * @return The buffer, or NULL on failure or when called outside a handler.
+ */
+char *cx_response_buffer(size_t *capacity);
+
+
+/**
+ * @brief Grows a buffer obtained from cx_response_buffer() to hold `needed` bytes.
+ *
+ * The first `*capacity` bytes are preserved. Capacity at least doubles, so
+ * repeated appends stay cheap.
+ *
+ * @param buf      The buffer.
+ * @param capacity In: current size of the buffer. Out: its new size.
+ * @param needed   Number of bytes the buffer must hold.
+ * @return The buffer (possibly moved), or NULL on failure (`buf` stays valid).
+ */
+char *cx_response_grow(char *buf, size_t *capacity, size_t needed);
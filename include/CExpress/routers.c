@@ -39,10 +39,15 @@ int same_router(const Router a, const Router b) {
  */
 int add_route(RouterList *router_lst, Router router) {
     if (router_lst->count == router_lst->capacity) {
+        if (router_lst->fixed) {
+            fprintf(stderr, "Route table full. Route not added.\n");
+            return 0;
+        }
         size_t new_cap = router_lst->capacity * 2;
-        Router *temp = realloc(router_lst->items, new_cap * sizeof(Router));
+        Router *temp = cx_realloc(MEM_ROUTER, router_lst->items, router_lst->capacity * sizeof(Router),
+                                  new_cap * sizeof(Router));
         if (!temp) {
-            perror("realloc failed. Route not added.");
+            perror("cx_realloc failed. Route not added.");
             return 0;
         }
         router_lst->items = temp;
@@ -99,44 +104,70 @@ int find_route(RouterList *router_lst, Router router) {
 }
 
 
+/**
+ * @brief Finds the route a raw request is for, comparing the request line in place.
+ *
+ * @param router_lst The list of registered routes.
+ * @param header     The raw HTTP request (NUL-terminated).
+ * @return The index of the matching route, or -1 if none matches.
+ */
+int match_route(const RouterList *router_lst, const char *header) {
+    static const char *method_names[] = {"GET", "POST", "PUT", "DELETE"};
+
+    const char *method_end = strchr(header, ' ');
+    if (!method_end) {
+        return -1;
+    }
+    size_t method_len = method_end - header;
+    int method = FAIL;
+    for (int m = GET; m < FAIL; m++) {
+        if (strlen(method_names[m]) == method_len && strncmp(header, method_names[m], method_len) == 0) {
+            method = m;
+        }
+    }
+    if (method == FAIL) {
+        return -1;
+    }
+
+    const char *path = method_end + 1;
+    size_t path_len = strcspn(path, " \r\n");
+    for (size_t i = 0; i < router_lst->count; i++) {
+        const Router *route = &router_lst->items[i];
+        if ((int)route->method == method && strlen(route->path) == path_len
+            && strncmp(route->path, path, path_len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 
 /**
  * @brief Extracts a Router from an HTTP header string.
  *
  * Parses the first line of the HTTP request to determine the method and path.
+ * Only the request line is tokenized, and all memory comes from `arena`, so the
+ * returned path is released with the rest of the request.
  *
  * @param header Pointer to the HTTP request string.
- * @return Router struct with method and path set. If parsing fails, returns a Router with all fields zeroed.
+ * @param arena  Arena the tokens and the path are allocated from.
+ * @return Router struct with method and path set. If parsing fails, returns a Router with method FAIL.
  */
-Router extract_router(const char *header) {
-    char **extracted_lines = extract_lines(header, strlen(header));
-    if (!extracted_lines) {
-        Router temp_router;
-        temp_router.method = FAIL;
-        temp_router.path = NULL;
-        temp_router.handler = NULL;
-        return temp_router;
-    }
-
-    char **header_sep = split(extracted_lines[0], strlen(extracted_lines[0]), ' ');
-    if (!header_sep) {
-       for (size_t i = 0; extracted_lines[i] != NULL; i++) {
-           free(extracted_lines[i]);
-       } 
-       free(extracted_lines);
-
-       Router temp_router;
-       temp_router.method = FAIL;
-       temp_router.path = NULL;
-       temp_router.handler = NULL;
-       return temp_router;
-    }
-    
+Router extract_router(const char *header, Arena *arena) {
     Router router;
     memset(&router, 0, sizeof(Router)); // Get rid of previous data
+    router.method = FAIL;
+
+    const char *line_end = strstr(header, "\r\n");
+    size_t line_len = line_end ? (size_t)(line_end - header) : strlen(header);
+
+    char **header_sep = split_arena(arena, header, line_len, ' ');
+    if (!header_sep || !header_sep[0] || !header_sep[1]) {
+        return router;
+    }
 
     const char *method = header_sep[0];
-    // typedef enum {GET, POST, PUT, DELETE} method_t;
+    // typedef enum {GET, POST, PUT, DELETE, FAIL} method_t;
     if (strcmp(method, "GET") == 0) {
         router.method = GET;
     } else if (strcmp(method, "POST") == 0) {
@@ -147,37 +178,25 @@ Router extract_router(const char *header) {
         router.method = DELETE;
     }
 
-    router.path = strdup(header_sep[1]);
-    
-    // Free all memory
-    for (size_t i = 0; extracted_lines[i] != NULL; i++) {
-        free(extracted_lines[i]);
-    }
-    free(extracted_lines);
-    for (size_t i = 0; header_sep[i] != NULL; i++) {
-        free(header_sep[i]);
-    }
-    free(header_sep);
-
+    router.path = header_sep[1];
     return router;
 }
 
 
 /**
- * @brief Processes an HTTP request header and attempts to execute the corresponding route handler.
+ * @brief Processes an HTTP request and attempts to execute the corresponding route handler.
  *
  * Parses the HTTP header to extract the method and path, searches for a matching route in the RouterList,
  * and invokes the associated handler if a match is found.
  *
- * @param header      The raw HTTP request header string.
- * @param client_sock The socket file descriptor of the connected client.
- * @param router_lst  The list of registered routes and their corresponding handlers.
+ * @param req        The request context. `req->route` is set to the matched route.
+ * @param router_lst The list of registered routes and their corresponding handlers.
  *
  * @return 1 if a matching route was found and its handler was executed successfully, 
  *         0 if no matching route exists or the header is invalid.
  */
-int process_header(const char *header, int client_sock, RouterList *router_lst) {
-    Router extracted_router = extract_router(header);
+int process_header(Request *req, RouterList *router_lst) {
+    Router extracted_router = extract_router(req->header, req->arena);
     if (extracted_router.method == FAIL) {
         return 0;
     }
@@ -188,5 +207,6 @@ int process_header(const char *header, int client_sock, RouterList *router_lst)
         return 0;
     }
     
-    return execute_handler(header, client_sock, router_lst->items[index].handler); 
+    req->route = &router_lst->items[index];
+    return execute_handler(req); 
 }
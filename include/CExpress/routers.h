@@ -14,6 +14,9 @@
 
 
 #include "utils.h"
+#include "alloc.h"
+#include "sizehist.h"
+#include "request.h"
 #include "handlers.h"
 
 
@@ -24,6 +27,18 @@
 typedef enum {GET, POST, PUT, DELETE, FAIL} method_t;
 
 
+/**
+ * @enum priority_t
+ * @brief Scheduling class of a route.
+ * - PRIORITY_CRITICAL : Health checks and admin endpoints. Served first, never shed, and
+ *                       admitted into capacity reserved for them.
+ * - PRIORITY_HIGH     : Latency-sensitive traffic (e.g. paying customers).
+ * - PRIORITY_NORMAL   : Default class.
+ * - PRIORITY_BULK     : Batch traffic that may wait.
+ */
+typedef enum {PRIORITY_CRITICAL, PRIORITY_HIGH, PRIORITY_NORMAL, PRIORITY_BULK, PRIORITY_COUNT} priority_t;
+
+
 /**
  * @typedef path_t
  * @brief Alias for representing a URL path.
@@ -38,10 +53,18 @@ typedef char * path_t;
  * A Router links an HTTP method and path to a handler function that processes
  * client requests for that specific route.
  */
-typedef struct {
+typedef struct Router {
     method_t method;
     path_t path;
     HandlerFunc handler;
+    int compress_level;       // zlib level for this route, -1 inherits the server default, 0 disables
+    long cache_ttl_ms;        // time-to-live of cached responses, 0 disables caching
+    SizeHistogram sizes;      // sizes of the bodies returned by the handler
+    priority_t priority;      // scheduling class of the route's requests
+    int max_in_flight;        // bulkhead: most requests admitted at once, 0 for no limit
+    int in_flight;            // requests admitted and not yet answered
+    size_t rejected;          // requests turned away by the bulkhead
+    long timeout_ms;          // deadline of the route's requests, 0 inherits the server default
 } Router;
 
 
@@ -56,6 +79,7 @@ typedef struct {
     Router *items;
     size_t count;
     size_t capacity;
+    int fixed;                // 1 if `items` is preallocated and must not be resized
 } RouterList;
 
 
@@ -99,24 +123,38 @@ int remove_route(RouterList *router_lst, Router router);
 int find_route(RouterList *router_lst, Router router);
 
 
+/**
+ * @brief Finds the route a raw request is for, without allocating.
+ *
+ * Used to classify requests before they are queued; process_header() does the
+ * full parsing when the request is served.
+ *
+ * @param router_lst The list of registered routes.
+ * @param header     The raw HTTP request (NUL-terminated).
+ * @return The index of the matching route, or -1 if none matches.
+ */
+int match_route(const RouterList *router_lst, const char *header);
+
+
 /**
  * @brief Extracts a Router object from an HTTP request header.
  *
  * @param header The raw HTTP request header string.
- * @return A Router object constructed from the header information.
+ * @param arena  Arena the extracted path is allocated from.
+ * @return A Router object constructed from the header information. Its path lives in
+ *         `arena` and must not be freed.
  */
-Router extract_router(const char *header);
+Router extract_router(const char *header, Arena *arena);
 
 
 /**
- * @brief Processes an HTTP request header and dispatches the request to the appropriate route handler.
+ * @brief Processes an HTTP request and dispatches it to the appropriate route handler.
  *
- * @param header      The raw HTTP request header string.
- * @param client_sock The socket file descriptor of the connected client.
- * @param router_lst  The list of registered routes and their corresponding handlers.
+ * @param req        The request context. `req->route` is set to the matched route.
+ * @param router_lst The list of registered routes and their corresponding handlers.
  *
  * @return 1 if the request was successfully processed and handled, 
  *         0 if no matching route was found.
  */
- int process_header(const char *header, int client_sock, RouterList *router_lst);
+int process_header(Request *req, RouterList *router_lst);
 
@@ -16,6 +16,7 @@
  *
  * **Key Functions:**
  *  - `server_init()`      : Creates and configures a new Server instance.
+ *  - `server_init_from_fd()` : Same, on a socket that is already bound.
  *  - `server_add_route()` : Registers a route with a handler for a specific HTTP method.
  *  - `server_start()`     : Begins accepting and handling client connections.
  *  - `server_free()`      : Frees all resources associated with the server.
@@ -43,82 +44,1192 @@
 
 #include "../include/CExpress/server.h"
 
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/signalfd.h>
+#endif
 
-volatile sig_atomic_t running = 0; // `volatile` prevents compiler optimizations that assume the value never changes unexpectedly.  
-                                   // `sig_atomic_t` guarantees atomic read/write in a signal handler (designed for sig handlers).
+
+// Signals are counted rather than flagged: every running server compares the
+// count with the ones it has acted on, so one signal reaches all of them.
+// `volatile` prevents compiler optimizations that assume the value never changes unexpectedly.
+// `sig_atomic_t` guarantees atomic read/write in a signal handler (designed for sig handlers).
+volatile sig_atomic_t sigint_count = 0;  // SIGINTs received: every running server stops
+volatile sig_atomic_t sigterm_count = 0; // SIGTERMs and SIGHUPs received: every running server drains
+volatile sig_atomic_t sigusr2_count = 0; // SIGUSR2s received: the process upgrades
+static Notify signal_notify = { -1, -1 }; // written by the handlers: wakes the loops, whichever thread got the signal
+static int signal_fd = -1;                // signalfd (Linux) receiving the signals loop threads block
+static pthread_once_t signals_once = PTHREAD_ONCE_INIT;
+static _Thread_local int loop_masked = 0;        // 1 while this thread runs a loop with the signals blocked
+static _Thread_local sigset_t loop_saved_mask;  // this thread's signal mask before its loop blocked them
+
+
+/**
+ * @brief Fills a set with the signals the servers handle.
+ */
+static void server_signal_set(sigset_t *set) {
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+    sigaddset(set, SIGHUP);
+    sigaddset(set, SIGUSR2);
+}
+
+
+/**
+ * @brief Gives a child forked from a loop thread the signal mask the thread had before its loop.
+ *
+ * The mask is inherited by children: without this, a child forked by a
+ * handler could not be stopped with SIGTERM.
+ */
+static void signals_atfork_child(void) {
+    if (loop_masked) {
+        pthread_sigmask(SIG_SETMASK, &loop_saved_mask, NULL);
+        loop_masked = 0;
+    }
+}
+
+
+/**
+ * @brief Opens the descriptors signals reach the running servers through.
+ *
+ * Loop threads block the signals and read them from the signalfd as ordinary
+ * events, without select() failing with EINTR. Other threads still get them
+ * through the handlers, which wake the loops with `signal_notify`.
+ */
+static void signals_init(void) {
+    if (!notify_open(&signal_notify)) {
+        fprintf(stderr, "Signals reach servers at their next tick.\n");
+    }
+#ifdef __linux__
+    sigset_t set;
+    server_signal_set(&set);
+    signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == -1) {
+        perror("signalfd failed. Signals interrupt the loop instead.");
+    }
+#endif
+    pthread_atfork(NULL, NULL, signals_atfork_child);
+}
+
+
+/**
+ * @brief Gives the signal mask processes started from the calling thread should have.
+ */
+void server_child_signal_mask(sigset_t *mask) {
+    if (loop_masked) {
+        *mask = loop_saved_mask;
+    } else {
+        pthread_sigmask(SIG_SETMASK, NULL, mask);
+    }
+}
+
+
+/**
+ * @brief Signal handler for SIGINT (Ctrl+C).
+ *
+ * This function is triggered when the process receives a SIGINT signal.
+ * It bumps the global `sigint_count`, which signals the main loop of every
+ * `server_start()` to exit gracefully.
+ *
+ * @param signum The signal number (unused).
+ *
+ * @note Uses `sig_atomic_t` to ensure atomic operations inside signal handler.
+ */
+void handler_sigint(int signum) {
+    sigint_count++; // Safe since type `sig_atomic_t`is designed for signal handlers
+    notify_signal(&signal_notify);
+}
+
+
+/**
+ * @brief Signal handler for SIGTERM and SIGHUP.
+ *
+ * Asks the main loops in `server_start()` to drain gracefully (see server_drain()).
+ *
+ * @param signum The signal number (unused).
+ */
+void handler_sigterm(int signum) {
+    sigterm_count++;
+    notify_signal(&signal_notify);
+}
+
+
+/**
+ * @brief Signal handler for SIGUSR2.
+ *
+ * Asks the main loops in `server_start()` to hand over to a new process (see server_upgrade()).
+ *
+ * @param signum The signal number (unused).
+ */
+void handler_sigusr2(int signum) {
+    sigusr2_count++;
+    notify_signal(&signal_notify);
+}
+
+
+#ifdef __linux__
+/**
+ * @brief Reads the signals queued on the signalfd and counts them as the handlers would.
+ */
+static void server_read_signals(void) {
+    struct signalfd_siginfo info;
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+        if (info.ssi_signo == SIGINT) {
+            handler_sigint(SIGINT);
+        } else if (info.ssi_signo == SIGUSR2) {
+            handler_sigusr2(SIGUSR2);
+        } else {
+            handler_sigterm((int)info.ssi_signo);
+        }
+    }
+}
+#endif
+
+
+// Servers whose loop runs, so signals, server_stop() and upgrades can reach them from any thread.
+static Server *running_servers[SERVER_MAX_RUNNING];
+static int num_running = 0;
+static sig_atomic_t upgrades_handled = 0; // SIGUSR2s already turned into an upgrade
+static pthread_mutex_t running_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * @brief Interrupts the select() of a running server.
+ *
+ * Async-signal-safe and thread-safe: only bumps the server's wakeup descriptor.
+ */
+static void server_wake(Server *server) {
+    notify_signal(&server->wake);
+}
+
+
+/**
+ * @brief Interrupts the select() of every running server.
+ *
+ * A signal interrupts one thread only: the server that notices it passes it on.
+ */
+static void server_wake_all(void) {
+    pthread_mutex_lock(&running_lock);
+    for (int i = 0; i < num_running; i++) {
+        server_wake(running_servers[i]);
+    }
+    pthread_mutex_unlock(&running_lock);
+}
+
+
+/**
+ * @brief Adds a server to the running servers and opens its wakeup descriptor.
+ *
+ * @return 1 on success, 0 if SERVER_MAX_RUNNING servers already run or the descriptor failed.
+ */
+static int server_register(Server *server) {
+    if (!notify_open(&server->wake)) {
+        fprintf(stderr, "Aborting server start.\n");
+        return 0;
+    }
+
+    pthread_mutex_lock(&running_lock);
+    int registered = num_running < SERVER_MAX_RUNNING;
+    if (registered) {
+        running_servers[num_running++] = server;
+        atomic_store(&server->running, 1);
+    }
+    pthread_mutex_unlock(&running_lock);
+    if (!registered) {
+        fprintf(stderr, "%d servers already run in this process. Aborting server start.\n", SERVER_MAX_RUNNING);
+        notify_close(&server->wake);
+    }
+    return registered;
+}
+
+
+/**
+ * @brief Removes a server from the running servers and closes its wakeup descriptor.
+ *
+ * Once this returns, server_stop() and server_drain() from other threads no
+ * longer touch the server, so it may be freed.
+ */
+static void server_unregister(Server *server) {
+    pthread_mutex_lock(&running_lock);
+    for (int i = 0; i < num_running; i++) {
+        if (running_servers[i] == server) {
+            running_servers[i] = running_servers[--num_running];
+            break;
+        }
+    }
+    atomic_store(&server->running, 0);
+    notify_close(&server->wake);
+    server->num_posts = 0; // work posted too late is dropped
+    pthread_mutex_unlock(&running_lock);
+}
+
+
+/**
+ * @brief Runs a callback on a running server's loop thread.
+ *
+ * @return 1 if the callback was queued, 0 otherwise.
+ */
+int cx_loop_post(Server *server, LoopTimerCallback callback, void *ctx) {
+    pthread_mutex_lock(&running_lock);
+    int queued = 0;
+    for (int i = 0; i < num_running && callback; i++) {
+        if (running_servers[i] == server && server->num_posts < LOOP_MAX_POSTS) {
+            server->posts[server->num_posts].callback = callback;
+            server->posts[server->num_posts].ctx = ctx;
+            server->num_posts++;
+            server_wake(server);
+            queued = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&running_lock);
+    return queued;
+}
+
+
+/**
+ * @brief Runs the callbacks other threads posted to the server, in order.
+ */
+static void server_run_posts(Server *server) {
+    LoopPost posts[LOOP_MAX_POSTS];
+    pthread_mutex_lock(&running_lock);
+    int count = server->num_posts;
+    memcpy(posts, server->posts, count * sizeof(LoopPost));
+    server->num_posts = 0;
+    pthread_mutex_unlock(&running_lock);
+    for (int i = 0; i < count; i++) {
+        posts[i].callback(posts[i].ctx);
+    }
+}
+
+
+/**
+ * @brief Unlinks a client slot from the activity list.
+ */
+static void lru_unlink(Server *server, int index) {
+    client_t *client = &server->client_lst[index];
+    if (client->lru_prev != -1) {
+        server->client_lst[client->lru_prev].lru_next = client->lru_next;
+    } else {
+        server->lru_head = client->lru_next;
+    }
+    if (client->lru_next != -1) {
+        server->client_lst[client->lru_next].lru_prev = client->lru_prev;
+    } else {
+        server->lru_tail = client->lru_prev;
+    }
+    client->lru_prev = client->lru_next = -1;
+}
+
+
+/**
+ * @brief Appends a client slot to the activity list as the most recently active one.
+ */
+static void lru_push(Server *server, int index, long long now) {
+    client_t *client = &server->client_lst[index];
+    client->last_active_ms = now;
+    client->lru_next = -1;
+    client->lru_prev = server->lru_tail;
+    if (server->lru_tail != -1) {
+        server->client_lst[server->lru_tail].lru_next = index;
+    } else {
+        server->lru_head = index;
+    }
+    server->lru_tail = index;
+}
+
+
+/**
+ * @brief Appends a client's request to the pending queue of its priority class.
+ */
+static void queue_push(Server *server, int index) {
+    client_t *client = &server->client_lst[index];
+    int cls = client->priority;
+    client->pending = 1;
+    client->arrival_us = now_us();
+    client->queue_next = -1;
+    client->queue_prev = server->queue_tail[cls];
+    if (server->queue_tail[cls] != -1) {
+        server->client_lst[server->queue_tail[cls]].queue_next = index;
+    } else {
+        server->queue_head[cls] = index;
+    }
+    server->queue_tail[cls] = index;
+    server->queued++;
+}
+
+
+/**
+ * @brief Takes a client's request out of the pending queue.
+ */
+static void queue_unlink(Server *server, int index) {
+    client_t *client = &server->client_lst[index];
+    int cls = client->priority;
+    if (client->queue_prev != -1) {
+        server->client_lst[client->queue_prev].queue_next = client->queue_next;
+    } else {
+        server->queue_head[cls] = client->queue_next;
+    }
+    if (client->queue_next != -1) {
+        server->client_lst[client->queue_next].queue_prev = client->queue_prev;
+    } else {
+        server->queue_tail[cls] = client->queue_prev;
+    }
+    client->queue_prev = client->queue_next = -1;
+    client->pending = 0;
+    server->queued--;
+}
+
+
+/**
+ * @brief Chooses the priority class to serve next.
+ *
+ * The critical class is always served first. The other classes share the
+ * server by smooth weighted round robin: each non-empty class earns its weight
+ * in credit per pick, and the richest class is served and pays the total.
+ *
+ * @return The class, or -1 if every queue is empty.
+ */
+static int queue_pick_class(Server *server) {
+    static const int weights[PRIORITY_COUNT] = { 0, SERVER_WEIGHT_HIGH, SERVER_WEIGHT_NORMAL, SERVER_WEIGHT_BULK };
+
+    if (server->queue_head[PRIORITY_CRITICAL] != -1) {
+        return PRIORITY_CRITICAL;
+    }
+    int best = -1;
+    int total = 0;
+    for (int cls = PRIORITY_CRITICAL + 1; cls < PRIORITY_COUNT; cls++) {
+        if (server->queue_head[cls] == -1) {
+            continue;
+        }
+        server->queue_credit[cls] += weights[cls];
+        total += weights[cls];
+        if (best == -1 || server->queue_credit[cls] > server->queue_credit[best]) {
+            best = cls;
+        }
+    }
+    if (best != -1) {
+        server->queue_credit[best] -= total;
+    }
+    return best;
+}
+
+
+/**
+ * @brief Stops counting a client's request against its route's bulkhead.
+ */
+static void route_release(Server *server, int index) {
+    client_t *client = &server->client_lst[index];
+    if (client->route >= 0) {
+        server->router_lst.items[client->route].in_flight--;
+        client->route = -1;
+    }
+}
+
+
+/**
+ * @brief Removes a client from the server's client list.
+ *
+ * Closes the client's socket, drops its pending request (if any),
+ * clears the client structure, and updates the active client count.
+ *
+ * @param server Pointer to the Server instance.
+ * @param index  Index of the client in the client list to remove.
+ */
+void remove_client(Server *server, int index) {
+    if (index < 0 || index >= server->max_clients) {
+        return;
+    }
+    
+    lru_unlink(server, index);
+    if (server->client_lst[index].pending) {
+        queue_unlink(server, index);
+        route_release(server, index);
+        if (server->concurrency.max_limit > 0) {
+            concurrency_abandon(&server->concurrency);
+        }
+    }
+    server->num_clients--;
+    server->listeners[server->client_lst[index].listener].active--;
+    if (server->client_lst[index].rate_counted) {
+        ratelimit_disconnect(&server->limiter, &server->client_lst[index].ip, server->client_lst[index].rate_counted);
+    }
+    close(server->client_lst[index].client_sock);         // close socket
+    output_free(&server->client_lst[index].out);          // unread responses are dropped
+    if (server->region.base) {
+        // Static budget mode: the slot keeps its preallocated read buffer.
+        char *buffer = server->client_lst[index].buffer;
+        memset(&server->client_lst[index], 0, sizeof(client_t));
+        server->client_lst[index].buffer = buffer;
+        return;
+    }
+    pool_free(server->client_lst[index].buffer, BUFFER_SIZE); // give the read buffer back
+    memset(&server->client_lst[index], 0, sizeof(client_t)); // zero out client struct
+}
+
+
+/**
+ * @brief Tells whether a connection has a request or response under way.
+ */
+static int client_busy(const client_t *client) {
+    return client->pending || client->read_len > 0 || output_pending(&client->out);
+}
+
+
+/**
+ * @brief Closes the least recently active idle keep-alive connection.
+ *
+ * Only connections that have been served at least once and stayed quiet for
+ * SERVER_EVICT_MIN_IDLE_MS qualify, so clients still sending their first
+ * request are never cut off. Connections with a request or response under way
+ * are skipped too. No response is in flight on an idle connection, so closing
+ * it is a normal keep-alive close for the client.
+ *
+ * @param server Pointer to the Server instance.
+ * @param now    Current monotonic time in milliseconds.
+ * @return 1 if a connection was closed, 0 if none was idle.
+ */
+static int evict_idle_client(Server *server, long long now) {
+    for (int i = server->lru_head; i != -1; i = server->client_lst[i].lru_next) {
+        client_t *client = &server->client_lst[i];
+        if (now - client->last_active_ms < SERVER_EVICT_MIN_IDLE_MS) {
+            return 0; // the list is ordered by activity: everyone after is busier
+        }
+        if (client->served > 0 && !client_busy(client)) {
+            remove_client(server, i);
+            server->evicted++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Raises the soft RLIMIT_NOFILE so the client table cannot run out of descriptors.
+ *
+ * The limit is raised as far as the hard limit permits, but never beyond
+ * FD_SETSIZE: select() cannot watch higher descriptors anyway. The usable
+ * limit is stored in `server->fd_limit`.
+ *
+ * @param server Pointer to the Server instance.
+ */
+static void server_raise_nofile(Server *server) {
+    server->fd_limit = FD_SETSIZE;
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("getrlimit failed. Descriptor limit unchanged.");
+        return;
+    }
+    rlim_t wanted = (rlim_t)server->max_clients + SERVER_FD_RESERVE;
+    if (wanted > FD_SETSIZE) {
+        wanted = FD_SETSIZE;
+    }
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted) {
+        rlim_t raised = (limit.rlim_max == RLIM_INFINITY || limit.rlim_max > wanted) ? wanted : limit.rlim_max;
+        struct rlimit updated = { .rlim_cur = raised, .rlim_max = limit.rlim_max };
+        if (setrlimit(RLIMIT_NOFILE, &updated) == 0) {
+            limit.rlim_cur = raised;
+        } else {
+            perror("setrlimit failed. Descriptor limit unchanged.");
+        }
+    }
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < (rlim_t)server->fd_limit) {
+        server->fd_limit = (int)limit.rlim_cur;
+    }
+    if ((rlim_t)server->max_clients + SERVER_FD_RESERVE > (rlim_t)server->fd_limit) {
+        fprintf(stderr, "Only %d descriptors available for %d clients: idle connections will be evicted early.\n",
+                server->fd_limit, server->max_clients);
+    }
+}
+
+
+/**
+ * @brief Tells whether the server is close to running out of client slots or descriptors.
+ *
+ * @param server Pointer to the Server instance.
+ * @param fd     The most recently accepted descriptor.
+ * @return 1 if idle connections should be evicted to keep room, 0 otherwise.
+ */
+static int server_near_capacity(const Server *server, int fd) {
+    return server->num_clients * 100 >= server->max_clients * SERVER_EVICT_PERCENT
+        || fd >= server->fd_limit - SERVER_FD_RESERVE;
+}
+
+
+/**
+ * @brief Returns the response cache bound for a pressure level.
+ *
+ * Full capacity without pressure, then a half, a quarter and nothing.
+ */
+static size_t pressure_cache_limit(size_t max_bytes, pressure_level_t level) {
+    return (level == PRESSURE_CRITICAL) ? 0 : max_bytes >> level;
+}
+
+
+/**
+ * @brief Closes connections transferring below the server's minimum rates.
+ *
+ * Uploads are measured from the first byte of a request (or the accept) to
+ * now; downloads over windows of `window_ms` while responses are unread.
+ *
+ * @param server Pointer to the Server instance.
+ * @param now    Current monotonic time in milliseconds.
+ */
+static void server_check_transfer_rates(Server *server, long long now) {
+    const TransferLimits *limits = &server->transfer;
+    if (limits->min_upload_rate == 0 && limits->min_download_rate == 0) {
+        return;
+    }
+    for (int i = 0; i < server->max_clients; i++) {
+        client_t *client = &server->client_lst[i];
+        if (client->client_sock <= 0 || client->pending) {
+            continue;
+        }
+        int slow = 0;
+        if (output_pending(&client->out)) {
+            long long elapsed = now - client->write_since_ms;
+            if (limits->min_download_rate > 0 && elapsed >= limits->window_ms) {
+                slow = client->write_bytes * 1000 < limits->min_download_rate * (size_t)elapsed;
+                client->write_since_ms = now; // next window
+                client->write_bytes = 0;
+            }
+        } else if (client->read_len > 0 || client->served == 0) {
+            long long elapsed = now - client->read_since_ms;
+            slow = limits->min_upload_rate > 0 && elapsed >= limits->window_ms
+                && client->read_len * 1000 < limits->min_upload_rate * (size_t)elapsed;
+        }
+        if (slow) {
+            server->slow_closed++;
+            remove_client(server, i);
+        }
+    }
+}
+
+
+/**
+ * @brief Runs periodic housekeeping from the event loop.
+ *
+ * Called at most once per SERVER_TICK_MS. Follows memory pressure by resizing
+ * the response cache, and returns pool slabs to the OS: those that stayed idle
+ * long enough normally, every free one while under pressure. Also enforces
+ * the minimum transfer rates.
+ *
+ * @param server Pointer to the Server instance.
+ */
+static void server_tick(Server *server) {
+    if (pressure_update(&server->pressure, now_ms())) {
+        pressure_level_t level = server->pressure.level;
+        size_t released = cache_set_limit(&server->cache, pressure_cache_limit(server->cache.max_bytes, level));
+        fprintf(stderr, "Memory pressure %s: response cache limited to %zu bytes, %zu bytes released.\n",
+                pressure_level_name(level), server->cache.limit, released);
+    }
+    pool_trim(server->pressure.level == PRESSURE_NONE ? POOL_IDLE_MS : 0);
+    if (server->limiter.slots) {
+        ratelimit_sweep(&server->limiter, now_ms());
+    }
+    server_check_transfer_rates(server, now_ms());
+}
+
+
+/**
+ * @brief Fills in the configuration fields shared by all Server initializers.
+ *
+ * Expects a zeroed Server.
+ */
+static void server_configure(Server *server, int port, int max_clients, int backlog, Mode mode) {
+    server->port = port;
+    server->max_clients = max_clients;
+    server->backlog = backlog;
+    server->mode = mode;
+    for (int i = 0; i < SERVER_MAX_LISTENERS; i++) {
+        server->listeners[i].fd = -1; // Will be changed later if socket creation successful. Set to -1 for safety.
+    }
+    server->num_listeners = 1;
+    server->compress_level = COMPRESS_DEFAULT_LEVEL;
+    server->compress_min_size = COMPRESS_DEFAULT_MIN_SIZE;
+    pressure_init(&server->pressure);
+    server->lru_head = -1;
+    server->lru_tail = -1;
+    for (int cls = 0; cls < PRIORITY_COUNT; cls++) {
+        server->queue_head[cls] = -1;
+        server->queue_tail[cls] = -1;
+    }
+    server->transfer.max_output = SERVER_MAX_OUTPUT;
+    server->transfer.window_ms = SERVER_RATE_WINDOW_MS;
+    server->drain_timeout_ms = SERVER_DRAIN_TIMEOUT_MS;
+    server->upgrade_fd = -1;
+    server->wake.read_fd = -1;
+    server->wake.write_fd = -1;
+    server->loop.timer_fd = -1;
+}
+
+
+/**
+ * @brief Takes an already bound socket as the server's listening socket.
+ *
+ * @param server Pointer to the Server instance.
+ * @param fd     The socket.
+ * @param origin Where the socket comes from, for the log.
+ */
+static void server_adopt(Server *server, int fd, const char *origin) {
+    socklen_t addr_len = sizeof(server->addr);
+    getsockname(fd, (struct sockaddr *)&server->addr, &addr_len);
+    server->listeners[0].fd = fd;
+    listener_name(fd, server->listeners[0].name, LISTENER_NAME_SIZE);
+    fprintf(stderr, "Using the listening socket %s on %s.\n", origin, server->listeners[0].name);
+}
+
+
+/**
+ * @brief Creates the server socket and binds it to the configured address.
+ *
+ * Sets socket options (SO_REUSEADDR) and binds according to the server's mode.
+ * A socket handed down by an upgrading process, or passed by a supervisor
+ * (socket activation), is used instead when there is one for the port.
+ * On failure the server is freed.
+ *
+ * @param server Pointer to the Server instance.
+ * @param fd     Socket given to server_init_from_fd(), or -1.
+ * @return 1 on success, 0 on failure.
+ */
+static int server_bind(Server *server, int fd) {
+    memset(&server->addr, 0, sizeof(server->addr));
+    server->addr.sin_family = AF_INET;
+    server->addr.sin_port = htons(server->port); // Necessary for big endian vs little endian
+    
+    if (server->mode == DEV) {
+        server->addr.sin_addr.s_addr = inet_addr(LOCALHOST_IP);
+        if (server->addr.sin_addr.s_addr == INADDR_NONE) {
+            perror("inet_addr failed for localhost. Aborting server initialization.");
+            server_free(server);
+            return 0;
+        }
+    } else if (server->mode == PROD) {
+        server->addr.sin_addr.s_addr = INADDR_ANY;
+    } else {
+        perror("Invalid mode specified. Must be DEV or PROD. Aborting server initialization.");
+        server_free(server);
+        return 0;
+    }
+        
+    if (fd != -1) {
+        server_adopt(server, fd, "given");
+        return 1;
+    }
+    // A process being upgraded hands its listening socket down: keep the port bound.
+    int inherited = upgrade_inherited_listener((struct sockaddr *)&server->addr, sizeof(server->addr));
+    if (inherited != -1) {
+        server_adopt(server, inherited, "inherited");
+        return 1;
+    }
+    // A supervisor may hold the port and queue connections while this process starts.
+    int activated = activation_listener((struct sockaddr *)&server->addr, sizeof(server->addr));
+    if (activated != -1) {
+        server_adopt(server, activated, "passed by the supervisor");
+        return 1;
+    }
+
+    // Socket creation (TCP, SO_REUSEADDR) and binding to the port
+    int sockfd = listener_open((struct sockaddr *)&server->addr, sizeof(server->addr));
+    if (sockfd == -1) {
+        fprintf(stderr, "Aborting server initialization.\n");
+        server_free(server);
+        return 0;
+    }
+    server->listeners[0].fd = sockfd;
+    listener_name(sockfd, server->listeners[0].name, LISTENER_NAME_SIZE);
+    return 1;
+}
 
 
 /**
- * @brief Signal handler for SIGINT (Ctrl+C).
+ * @brief Prepares framework memory before the event loop starts.
  *
- * This function is triggered when the server receives a SIGINT signal.
- * It sets the global `running` flag to 0, which signals the main loop
- * in `server_start()` to exit gracefully.
+ * With prefaulting, the pool slabs the server will need (read buffers, arena
+ * chunks, compression output) are mapped and faulted in now rather than on the
+ * first requests. Memory is then locked if requested and a report is printed.
  *
- * @param signum The signal number (unused).
+ * @param server Pointer to the Server instance.
+ * @return 1 on success, 0 if locking was requested and failed.
+ */
+static int server_prepare_memory(Server *server) {
+    const MemoryOptions *options = cx_get_memory_options();
+    if (options->huge_pages == HUGE_PAGES_NONE && !options->prefault && !options->lock_memory) {
+        return 1;
+    }
+
+    if (options->prefault && !server->region.base) {
+        pool_reserve(BUFFER_SIZE, server->max_clients);
+        pool_reserve(ARENA_CHUNK_SIZE, ARENA_RETAIN_BYTES / ARENA_CHUNK_SIZE);
+        pool_reserve(COMPRESS_CHUNK_SIZE, 1);
+    }
+    return memory_lock_and_report();
+}
+
+
+/**
+ * @brief Finds the address rate limits key a peer on.
  *
- * @note Uses `sig_atomic_t` to ensure atomic operations inside signal handler.
+ * IPv4 peers are keyed as IPv4-mapped IPv6 addresses.
+ *
+ * @param addr Peer address.
+ * @param ip   Receives the key.
+ * @return 1 for an IPv4 or IPv6 peer, 0 for a peer without an address (Unix socket).
  */
-void handler_sigint(int signum) {
-    running = 0; // Safe since type `sig_atomic_t`is designed for signal handlers
+static int peer_rate_addr(const struct sockaddr_storage *addr, RateAddr *ip) {
+    if (addr->ss_family == AF_INET) {
+        ip->hi = 0;
+        ip->lo = 0xFFFF00000000ULL | ntohl(((const struct sockaddr_in *)addr)->sin_addr.s_addr);
+        return 1;
+    }
+    if (addr->ss_family == AF_INET6) {
+        const uint8_t *bytes = ((const struct sockaddr_in6 *)addr)->sin6_addr.s6_addr;
+        ip->hi = 0;
+        ip->lo = 0;
+        for (int i = 0; i < 8; i++) {
+            ip->hi = (ip->hi << 8) | bytes[i];
+            ip->lo = (ip->lo << 8) | bytes[i + 8];
+        }
+        return 1;
+    }
+    return 0;
 }
 
 
 /**
- * @brief Removes a client from the server's client list.
+ * @brief Sends a canned error response before the connection is dropped.
+ *
+ * Best effort, and without SIGPIPE: the clients refused, shed or timed out
+ * here are the ones most likely to have reset the connection already.
+ */
+static void send_error(int sock, const char *response) {
+    send(sock, response, strlen(response), MSG_NOSIGNAL);
+}
+
+
+/**
+ * @brief Asks the kernel to busy poll the device queue of a socket.
+ *
+ * Values above net.core.busy_read need CAP_NET_ADMIN.
+ *
+ * @return 1 on success, 0 if the option was refused or is not supported.
+ */
+static int busy_poll_socket(int fd, long spin_us) {
+#ifdef SO_BUSY_POLL
+    int value = (spin_us > INT_MAX) ? INT_MAX : (int)spin_us;
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) < 0) {
+        return 0;
+    }
+#ifdef SO_PREFER_BUSY_POLL
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one)); // Linux 5.11 and later
+#endif
+    return 1;
+#else
+    (void)fd;
+    (void)spin_us;
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Tells whether the loop still spins instead of blocking in select().
+ *
+ * @return 1 within the busy poll interval after the last activity, 0 otherwise.
+ */
+static int server_spinning(const Server *server) {
+    return server->busy_poll_us > 0 && now_us() - server->last_active_us < server->busy_poll_us;
+}
+
+
+/**
+ * @brief Moves the loop thread to SCHED_FIFO for busy polling, if asked to.
+ *
+ * @param server     Pointer to the Server instance.
+ * @param old_policy Receives the thread's scheduling policy before the change.
+ * @param old_param  Receives the thread's scheduling parameters before the change.
+ * @return 1 if the policy changed (restore it afterwards), 0 otherwise.
+ */
+static int server_enter_realtime(const Server *server, int *old_policy, struct sched_param *old_param) {
+    if (server->busy_poll_us == 0 || server->busy_poll_priority == 0) {
+        return 0;
+    }
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        // A spinning SCHED_FIFO thread would keep its own clients off the only CPU.
+        fprintf(stderr, "One CPU online: busy polling at the normal priority instead of SCHED_FIFO.\n");
+        return 0;
+    }
+    pthread_getschedparam(pthread_self(), old_policy, old_param);
+    struct sched_param param = { .sched_priority = server->busy_poll_priority };
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+        fprintf(stderr, "SCHED_FIFO priority %d refused (%s). Busy polling at the normal priority.\n",
+                server->busy_poll_priority, strerror(rc));
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Accepts one connection from a listening socket's backlog.
  *
- * Closes the client's socket, clears the client structure, 
- * and updates the active client count.
+ * The connection gets a client slot and a read buffer, or is refused with a
+ * 429 (over its rate limit caps) or a 503 (no slot left).
+ *
+ * @param server   Pointer to the Server instance.
+ * @param listener Index of the listener.
+ * @param now      Current monotonic time in milliseconds.
+ * @return 1 if the backlog may hold more connections, 0 once it is empty (or on error).
+ */
+static int accept_client(Server *server, int listener, long long now) {
+    struct sockaddr_storage client_addr;
+    socklen_t size_struct = sizeof(client_addr);
+
+    int new_socket = accept(server->listeners[listener].fd, (struct sockaddr *)&client_addr, &size_struct);
+    if (new_socket < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0; // backlog drained
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            return 1;
+        }
+        if ((errno == EMFILE || errno == ENFILE) && evict_idle_client(server, now)) {
+            return 1; // a descriptor is free again: retry the pending client
+        }
+        perror("accept failed. Skipping.");
+        return 0;
+    }
+
+    // Non-blocking client: a slow reader's responses are buffered instead of stalling the loop.
+    int flags = fcntl(new_socket, F_GETFL, 0);
+    if (flags != -1) {
+        fcntl(new_socket, F_SETFL, flags | O_NONBLOCK);
+    }
+    if (server->busy_poll_us > 0) {
+        busy_poll_socket(new_socket, server->busy_poll_us);
+    }
+
+    RateAddr client_ip;
+    int has_ip = peer_rate_addr(&client_addr, &client_ip);
+    int counted = 0;
+    if (server->limiter.slots && has_ip && !ratelimit_connect(&server->limiter, &client_ip, now, &counted)) {
+        // This client (or its /24 or /64) already holds its share of the connections.
+        send_error(new_socket, RESPONSE_TOO_MANY_REQUESTS);
+        close(new_socket);
+        server->listeners[listener].refused++;
+        return 1;
+    }
+
+    // Close to the slot or descriptor limit: make room by dropping an idle keep-alive connection.
+    if (server_near_capacity(server, new_socket)) {
+        evict_idle_client(server, now);
+    }
+
+    int slot = -1;
+    for (int i = 0; i< server->max_clients; i++) {
+        if (server->num_clients >= server->max_clients || new_socket >= FD_SETSIZE) {
+            break; // full, or a descriptor select() cannot watch
+        }
+        if (server->client_lst[i].client_sock == 0) {
+            char *buffer = server->client_lst[i].buffer ? server->client_lst[i].buffer
+                                                        : pool_alloc(BUFFER_SIZE);
+            if (!buffer) {
+                break;
+            }
+            server->num_clients++;
+            server->client_lst[i].client_sock = new_socket;
+            server->client_lst[i].addr = client_addr;
+            server->client_lst[i].ip = client_ip;
+            server->client_lst[i].has_ip = has_ip;
+            server->client_lst[i].rate_counted = counted;
+            server->client_lst[i].listener = listener;
+            server->listeners[listener].accepted++;
+            server->listeners[listener].active++;
+            server->client_lst[i].buffer = buffer;
+            server->client_lst[i].served = 0;
+            server->client_lst[i].read_len = 0;
+            server->client_lst[i].read_since_ms = now;
+            // Static budget mode cannot buffer responses: its writes wait for the client instead.
+            output_init(&server->client_lst[i].out, server->region.base ? 0 : server->transfer.max_output);
+            lru_push(server, i, now);
+            slot = i;
+            break;
+        }
+    }
+    if (slot == -1) {
+        // No slot (or no buffer) left: refuse explicitly instead of leaking the socket.
+        send_error(new_socket, RESPONSE_UNAVAILABLE);
+        close(new_socket);
+        server->listeners[listener].refused++;
+        if (counted) {
+            ratelimit_disconnect(&server->limiter, &client_ip, counted);
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Serves one queued request and sends its response.
  *
  * @param server Pointer to the Server instance.
- * @param index  Index of the client in the client list to remove.
+ * @param index  Slot of the client whose request is served (already out of the queue).
  */
-void remove_client(Server *server, int index) {
-    if (index < 0 || index >= server->max_clients) {
+static void serve_request(Server *server, int index) {
+    client_t *client = &server->client_lst[index];
+    Request req = {
+        .header = client->buffer,
+        .header_len = client->request_len,
+        .client_sock = client->client_sock,
+        .out = &client->out,
+        .server = server,
+        .route = NULL,
+        .arena = &server->arena,
+        .deadline_us = client->deadline_us,
+        .close = server->draining,
+    };
+    int handled = process_header(&req, &server->router_lst);
+    int exhausted = server->arena.exhausted;
+    arena_reset(&server->arena); // response sent: release all request memory at once
+    route_release(server, index);
+    if (server->concurrency.max_limit > 0) {
+        concurrency_release(&server->concurrency, now_us() - client->arrival_us);
+    }
+    if (!handled) {
+        // Route not found or handler failed (503 if the request ran out of its memory budget).
+        // Nothing is sent behind a response the client has not read: it would interleave.
+        const char *response = exhausted ? RESPONSE_UNAVAILABLE : RESPONSE_NOT_FOUND;
+        if (!output_pending(&client->out)) {
+            send_error(client->client_sock, response);
+        }
+        if (client->out.overflow) {
+            server->slow_closed++;
+        }
+
+        remove_client(server, index);
         return;
     }
-    
-    close(server->client_lst[index].client_sock);         // close socket
-    memset(&server->client_lst[index], 0, sizeof(client_t)); // zero out client struct
+    if (output_pending(&client->out) && client->write_since_ms == 0) {
+        // The client is behind: start measuring how fast it catches up.
+        client->write_since_ms = now_ms();
+        client->write_bytes = 0;
+    }
+    if (req.close) {
+        // Draining or timed out: the response said "Connection: close".
+        if (output_pending(&client->out)) {
+            client->closing = 1;
+        } else {
+            remove_client(server, index);
+            return;
+        }
+    }
+    // Served: the connection is now the most recently active one.
+    client->served++;
+    lru_unlink(server, index);
+    lru_push(server, index, now_ms());
 }
 
 
 /**
- * @brief Initializes a new Server instance.
+ * @brief Computes the deadline of a request that was just read.
  *
- * Allocates and configures a server structure, creates the TCP socket,
- * sets socket options (SO_REUSEADDR), and binds the socket to the given port.
+ * The route's timeout, or the server default, may be shortened by the client
+ * with an SERVER_TIMEOUT_HEADER header.
  *
- * @param port        The TCP port number for the server to listen on.
- * @param max_clients Maximum number of concurrent clients supported.
- * @param backlog     Maximum number of queued connection requests.
- * @param mode Server binding mode:
- *        - DEV  : Bind to localhost (127.0.0.1), restricting access to the local machine.
- *        - PROD : Bind to all interfaces (0.0.0.0), allowing external network access.
+ * @return Monotonic deadline in microseconds, or 0 for none.
+ */
+static long long request_deadline(const Server *server, const Router *route, const char *header,
+                                  long long arrival_us) {
+    long timeout_ms = (route && route->timeout_ms > 0) ? route->timeout_ms : server->timeout_ms;
+
+    char value[32];
+    if (get_header_value(header, SERVER_TIMEOUT_HEADER, value, sizeof(value))) {
+        long requested = strtol(value, NULL, 10);
+        if (requested > 0 && (timeout_ms == 0 || requested < timeout_ms)) {
+            timeout_ms = requested;
+        }
+    }
+    return (timeout_ms > 0) ? arrival_us + (long long)timeout_ms * 1000 : 0;
+}
+
+
+/**
+ * @brief Serves queued requests for up to SERVER_SERVE_BUDGET_US.
  *
- * @return Pointer to a dynamically allocated Server structure on success, 
- *         or NULL on failure.
+ * Classes are picked by queue_pick_class(), and each class queue is served
+ * oldest first. With shedding enabled, requests that waited too long are
+ * answered with a 503 instead, and while the server is overloaded the newest
+ * request of a class is served first (adaptive LIFO). Critical requests are
+ * never shed, but requests of any class whose deadline passed while queued are
+ * dropped. Requests left when the budget runs out stay queued, so new
+ * connections and requests are polled in between.
  *
- * @note Caller is responsible for freeing resources using `server_free()`.
+ * @param server Pointer to the Server instance.
  */
-Server *server_init(int port, int max_clients, int backlog, Mode mode) {
+static void server_serve_queue(Server *server) {
+    long long start = now_us();
+    while (server->queued > 0) {
+        long long now = now_us();
+        if (now - start >= SERVER_SERVE_BUDGET_US) {
+            break;
+        }
+
+        int cls = queue_pick_class(server);
+        int shedding = server->codel.target_us > 0 && cls != PRIORITY_CRITICAL;
+        int lifo = shedding && server->codel.overloaded;
+        int index = lifo ? server->queue_tail[cls] : server->queue_head[cls];
+        client_t *client = &server->client_lst[index];
+
+        if (shedding && codel_should_drop(&server->codel, now - client->arrival_us, now)) {
+            // The client has most likely given up: shed the request.
+            send_error(client->client_sock, RESPONSE_UNAVAILABLE);
+            remove_client(server, index);
+            continue;
+        }
+        if (client->deadline_us != 0 && now >= client->deadline_us) {
+            // Nobody is waiting for this response any more: skip the work.
+            server->expired++;
+            send_error(client->client_sock, RESPONSE_UNAVAILABLE);
+            remove_client(server, index);
+            continue;
+        }
+        queue_unlink(server, index);
+        serve_request(server, index);
+    }
+}
+
+
+/**
+ * @brief Closes every listening socket.
+ */
+static void server_close_listeners(Server *server) {
+    for (int i = 0; i < server->num_listeners; i++) {
+        if (server->listeners[i].fd != -1) {
+            close(server->listeners[i].fd);
+            server->listeners[i].fd = -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Puts the server in draining state (see server_drain()).
+ *
+ * Runs on the server's own loop.
+ */
+static void server_begin_drain(Server *server) {
+    if (server->draining) {
+        return;
+    }
+    server->draining = 1;
+    server->ready = 0;
+    server->drain_start_ms = now_ms();
+    fprintf(stderr, "Draining: accepting for %ld ms more, then up to %ld ms for in-flight work.\n",
+            server->drain_delay_ms, server->drain_timeout_ms);
+}
+
+
+/**
+ * @brief Advances a graceful drain.
+ *
+ * Closes the listener once the drain delay is over and idle keep-alive
+ * connections right away. Connections that never sent a byte are closed
+ * once the listener is: nothing is in flight on them. A connection whose
+ * request already waits in its socket buffer is kept, and is served with
+ * "Connection: close" instead.
+ *
+ * @param server Pointer to the Server instance.
+ * @param now    Current monotonic time in milliseconds.
+ * @return 1 while the drain goes on, 0 once the server may stop.
+ */
+static int server_drain_step(Server *server, long long now) {
+    long long elapsed = now - server->drain_start_ms;
+    int listening = elapsed < server->drain_delay_ms;
+    if (!listening) {
+        server_close_listeners(server); // stop accepting: new connections are refused by the kernel
+    }
+    for (int i = 0; i < server->max_clients; i++) {
+        client_t *client = &server->client_lst[i];
+        int unread = 0;
+        if (client->client_sock > 0 && (client->served > 0 || !listening) && !client_busy(client)
+            && (ioctl(client->client_sock, FIONREAD, &unread) == -1 || unread == 0)) {
+            remove_client(server, i); // idle keep-alive, or silent since accepted (preconnects, health sockets)
+        }
+    }
+
+    if (!listening && server->num_clients == 0) {
+        fprintf(stderr, "Drain complete.\n");
+        return 0;
+    }
+    if (elapsed >= server->drain_delay_ms + server->drain_timeout_ms) {
+        fprintf(stderr, "Drain timed out with %d connection(s) left.\n", server->num_clients);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Handles the report of the process an upgrade started.
+ *
+ * A byte means the new process serves: every server of this process drains.
+ * End-of-file means it died first: the upgrade is abandoned and they keep serving.
+ *
+ * @param server Pointer to the Server instance.
+ */
+static void server_upgrade_progress(Server *server) {
+    char byte;
+    ssize_t n = read(server->upgrade_fd, &byte, 1);
+    if (n < 0 && errno == EINTR) {
+        return;
+    }
+    close(server->upgrade_fd);
+    server->upgrade_fd = -1;
+    if (n == 1) {
+        fprintf(stderr, "Upgrade: the new process is serving.\n");
+        pthread_mutex_lock(&running_lock);
+        for (int i = 0; i < num_running; i++) {
+            atomic_store(&running_servers[i]->drain_pending, 1);
+            server_wake(running_servers[i]);
+        }
+        pthread_mutex_unlock(&running_lock);
+    } else {
+        fprintf(stderr, "Upgrade failed: the new process exited before serving. Still serving.\n");
+        waitpid(server->upgrade_pid, NULL, 0); // the pipe only closes early when it exits
+    }
+}
+
+
+/**
+ * @brief Allocates a Server and gives it its listening socket.
+ *
+ * @param fd Already bound socket to use, or -1 to bind one (see server_bind()).
+ * @return Pointer to the Server on success, or NULL on failure.
+ */
+static Server *server_create(int port, int max_clients, int backlog, Mode mode, int fd) {
     // setup server struct
-    Server *server = malloc(sizeof(Server));
+    Server *server = cx_malloc(MEM_SERVER, sizeof(Server));
     if (!server) {
-        perror("malloc failed. aborting server initialization.");
+        perror("cx_malloc failed. aborting server initialization.");
         return NULL;
     }
+    memset(server, 0, sizeof(Server));
+    server_configure(server, port, max_clients, backlog, mode);
 
-    server->port = port;
-    server->max_clients = max_clients;
-    server->backlog = backlog;
-    server->mode = mode;
-    server->sockfd = -1; // Will be changed later if socket creation successful. Set to -1 for safety.
-
-    server->client_lst = malloc(sizeof(client_t) * max_clients);
+    server->client_lst = cx_malloc(MEM_SERVER, sizeof(client_t) * max_clients);
     if (!server->client_lst) {
-        perror("malloc failed. aborting server initialization.");
-        free(server);
+        perror("cx_malloc failed. aborting server initialization.");
+        cx_free(MEM_SERVER, server, sizeof(Server));
         return NULL;
     }
 
@@ -129,59 +1240,115 @@ Server *server_init(int port, int max_clients, int backlog, Mode mode) {
     // Initialize global router list for the server
     server->router_lst.count = 0;
     server->router_lst.capacity = 4;
-    server->router_lst.items = malloc(server->router_lst.capacity * sizeof(Router));
+    server->router_lst.items = cx_malloc(MEM_ROUTER, server->router_lst.capacity * sizeof(Router));
     if (!server->router_lst.items) {
-        perror("malloc failed. aborting server initialization.");
-        free(server->client_lst);
-        free(server);
+        perror("cx_malloc failed. aborting server initialization.");
+        cx_free(MEM_SERVER, server->client_lst, sizeof(client_t) * max_clients);
+        cx_free(MEM_SERVER, server, sizeof(Server));
         return NULL;
     }
     memset(server->router_lst.items, 0, server->router_lst.capacity * sizeof(Router));
-        
-    memset(&server->addr, 0, sizeof(server->addr));
-    server->addr.sin_family = AF_INET;
-    server->addr.sin_port = htons(port); // Necessary for big endian vs little endian
-    
-    if (mode == DEV) {
-        server->addr.sin_addr.s_addr = inet_addr(LOCALHOST_IP);
-        if (server->addr.sin_addr.s_addr == INADDR_NONE) {
-            perror("inet_addr failed for localhost. Aborting server initialization.");
-            server_free(server);
-            return NULL;
-        }
-    } else if (mode == PROD) {
-        server->addr.sin_addr.s_addr = INADDR_ANY;
-    } else {
-        perror("Invalid mode specified. Must be DEV or PROD. Aborting server initialization.");
-        server_free(server);
+
+    if (!cache_init(&server->cache, CACHE_DEFAULT_MAX_BYTES)) {
+        cx_free(MEM_ROUTER, server->router_lst.items, server->router_lst.capacity * sizeof(Router));
+        cx_free(MEM_SERVER, server->client_lst, sizeof(client_t) * max_clients);
+        cx_free(MEM_SERVER, server, sizeof(Server));
         return NULL;
     }
-        
-    // Socket creation
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0); // Protocol set by default to TCP
-    if (sockfd == -1) {
-        perror("socket creation failed. Aborting server initialization.");
-        server_free(server);
+
+    return server_bind(server, fd) ? server : NULL;
+}
+
+
+/**
+ * @brief Initializes a new Server instance.
+ *
+ * Allocates and configures a server structure, creates the TCP socket,
+ * sets socket options (SO_REUSEADDR), and binds the socket to the given port.
+ *
+ * @param port        The TCP port number for the server to listen on.
+ * @param max_clients Maximum number of concurrent clients supported.
+ * @param backlog     Maximum number of queued connection requests.
+ * @param mode Server binding mode:
+ *        - DEV  : Bind to localhost (127.0.0.1), restricting access to the local machine.
+ *        - PROD : Bind to all interfaces (0.0.0.0), allowing external network access.
+ *
+ * @return Pointer to a dynamically allocated Server structure on success, 
+ *         or NULL on failure.
+ *
+ * @note Caller is responsible for freeing resources using `server_free()`.
+ */
+Server *server_init(int port, int max_clients, int backlog, Mode mode) {
+    return server_create(port, max_clients, backlog, mode, -1);
+}
+
+
+/**
+ * @brief Initializes a Server on a socket that is already bound.
+ *
+ * @return Pointer to the Server on success, or NULL on failure.
+ */
+Server *server_init_from_fd(int fd, int max_clients, int backlog) {
+    int port = socket_port(fd, NULL);
+    if (port == -1) {
+        fprintf(stderr, "Descriptor %d is not a bound TCP socket. Aborting server initialization.\n", fd);
         return NULL;
     }
-    server->sockfd = sockfd;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return server_create(port, max_clients, backlog, PROD, fd);
+}
 
-    int opt = 1;
-    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        perror("setsockopt failed. Aborting server initialization.");
-        server_free(server);
+
+/**
+ * @brief Initializes a Server whose memory is entirely carved from one region.
+ *
+ * The region holds the Server itself, the client table, one read buffer per
+ * client slot, the route table and the request arena. Response caching is
+ * disabled, since cache entries would need allocations of their own.
+ *
+ * @return Pointer to the Server (inside the region) on success, or NULL on failure.
+ *
+ * @note Caller is responsible for freeing resources using `server_free()`.
+ */
+Server *server_init_static(int port, int max_clients, int backlog, Mode mode, const MemoryBudget *budget) {
+    if (!budget || max_clients <= 0 || budget->max_routes == 0 || budget->arena_bytes <= sizeof(ArenaChunk)) {
+        fprintf(stderr, "Invalid memory budget. Aborting server initialization.\n");
         return NULL;
     }
 
-    // Bind socket to port
-    int bind_res = bind(sockfd, (struct sockaddr*)&server->addr, sizeof(server->addr));
-    if (bind_res == -1) {
-        perror("socket binding failed. Aborting server initialization.");
-        server_free(server);
+    size_t slack = 16 * sizeof(max_align_t); // alignment padding between carved blocks
+    size_t total = sizeof(Server)
+                 + (size_t)max_clients * (sizeof(client_t) + BUFFER_SIZE)
+                 + budget->max_routes * sizeof(Router)
+                 + budget->arena_bytes
+                 + (size_t)max_clients * sizeof(max_align_t) + slack;
+
+    Region region;
+    if (!region_init(&region, total)) {
         return NULL;
     }
-    
-    return server;
+
+    Server *server = region_alloc(&region, sizeof(Server));
+    server->region = region; // from here on, carve through server->region
+    server_configure(server, port, max_clients, backlog, mode);
+
+    server->client_lst = region_alloc(&server->region, sizeof(client_t) * max_clients);
+    for (int i = 0; i < max_clients; i++) {
+        server->client_lst[i].buffer = region_alloc(&server->region, BUFFER_SIZE);
+    }
+
+    server->router_lst.items = region_alloc(&server->region, budget->max_routes * sizeof(Router));
+    server->router_lst.capacity = budget->max_routes;
+    server->router_lst.fixed = 1;
+
+    arena_init_fixed(&server->arena, region_alloc(&server->region, budget->arena_bytes), budget->arena_bytes);
+    server->cache.max_bytes = 0; // caching would allocate
+    server->cache.limit = 0;
+
+    fprintf(stderr, "Static memory budget: %zu bytes reserved for %d clients, %zu routes, %zu-byte request arena.\n",
+            server->region.size, max_clients, budget->max_routes, budget->arena_bytes);
+
+    return server_bind(server, -1) ? server : NULL;
 }
 
 
@@ -196,13 +1363,19 @@ Server *server_init(int port, int max_clients, int backlog, Mode mode) {
 void server_free(Server *server) {
     if (!server) return;
 
-    if (server->sockfd != -1) {
-        close(server->sockfd);
+    server_close_listeners(server);
+    ratelimit_free(&server->limiter);
+    if (server->region.base) {
+        // Static budget mode: everything, including the Server, lives in the region.
+        region_free(server->region);
+        return;
     }
-    // Free global router list
-    free(server->router_lst.items);
-    free(server->client_lst);
-    free(server);
+    // Free global router list and cached responses
+    cx_free(MEM_ROUTER, server->router_lst.items, server->router_lst.capacity * sizeof(Router));
+    cache_free(&server->cache);
+    arena_free(&server->arena);
+    cx_free(MEM_SERVER, server->client_lst, sizeof(client_t) * server->max_clients);
+    cx_free(MEM_SERVER, server, sizeof(Server));
 }
 
 
@@ -220,21 +1393,40 @@ void server_free(Server *server) {
  *
  * @return 1 on successful shutdown, -1 if an error occurred during setup.
  *
- * @note This function runs an infinite loop until interrupted by SIGINT.
+ * @note This function runs an infinite loop until interrupted by SIGINT or server_stop().
  *       When the loop terminates, server_free() is automatically called to clean up resources.
  */
 int server_start(Server *server) {
     fd_set sock_set;     // all client/server sockets being monitored by server (used for select() sys call)
-    int max_fd, num_clients = 0;         
+    fd_set write_set;    // client sockets with unread responses waiting to be flushed
+    int max_fd;
+    long long last_tick = now_ms();
 
-    // Listen for connections
-    if (listen(server->sockfd, server->backlog) < 0) {
-        perror("listen failed. Aborting server start.");
-        // server_free(server);
+    for (int i = 0; i < server->num_listeners; i++) {
+        // Listen for connections
+        if (listen(server->listeners[i].fd, server->backlog) < 0) {
+            perror("listen failed. Aborting server start.");
+            // server_free(server);
+            return -1;
+        }
+
+        // Non-blocking listener: each pass accepts until the backlog is empty.
+        int flags = fcntl(server->listeners[i].fd, F_GETFL, 0);
+        if (flags == -1 || fcntl(server->listeners[i].fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            perror("fcntl failed. Aborting server start.");
+            return -1;
+        }
+    }
+
+    server_raise_nofile(server);
+
+    if (!server_prepare_memory(server)) {
+        fprintf(stderr, "Memory preparation failed. Aborting server start.\n");
         return -1;
     }
 
     // Setup signal handling
+    pthread_once(&signals_once, signals_init);
     struct sigaction newact;
     newact.sa_handler = handler_sigint;
     newact.sa_flags = 0;
@@ -245,19 +1437,102 @@ int server_start(Server *server) {
         // server_free(server);
         return -1;
     }
+    newact.sa_handler = handler_sigterm;
+    if (sigaction(SIGTERM, &newact, NULL) == -1 || sigaction(SIGHUP, &newact, NULL) == -1) {
+        perror("sigaction failed. Aborting server start.");
+        return -1;
+    }
+    newact.sa_handler = handler_sigusr2;
+    if (sigaction(SIGUSR2, &newact, NULL) == -1) {
+        perror("sigaction failed. Aborting server start.");
+        return -1;
+    }
+
+    // Signals that arrived before this server started are not its own.
+    server->seen_sigint = sigint_count;
+    server->seen_sigterm = sigterm_count;
+    if (!server_register(server)) {
+        return -1;
+    }
+    sigset_t signals;
+    server_signal_set(&signals);
+    if (signal_fd != -1) {
+        pthread_sigmask(SIG_BLOCK, &signals, &loop_saved_mask); // this thread reads them from the signalfd
+        loop_masked = 1;
+    }
+    loop_open(&server->loop);
+    if (server->busy_poll_us > 0) {
+        for (int i = 0; i < server->num_listeners; i++) {
+            if (server->listeners[i].fd != -1 && !busy_poll_socket(server->listeners[i].fd, server->busy_poll_us)) {
+                perror("SO_BUSY_POLL refused. The loop spins without kernel busy polling.");
+                break;
+            }
+        }
+        server->last_active_us = now_us();
+    }
+    int old_policy;
+    struct sched_param old_param;
+    int realtime = server_enter_realtime(server, &old_policy, &old_param);
+    server->ready = 1;
+    loop_set_current(server);
+    upgrade_notify_ready(0); // once every handed-down socket is taken, the process taken over from may drain
 
-    // Set signal var
-    running = 1;
+    while (atomic_load(&server->running)) {
+        if (server->seen_sigint != sigint_count) {
+            break;
+        }
+        if (server->seen_sigterm != sigterm_count) {
+            server->seen_sigterm = sigterm_count;
+            server_begin_drain(server);
+        }
+        if (atomic_exchange(&server->drain_pending, 0)) {
+            server_begin_drain(server);
+        }
+        server_run_posts(server);
+        if (upgrades_handled != sigusr2_count) {
+            pthread_mutex_lock(&running_lock);
+            int claimed = upgrades_handled != sigusr2_count; // one server upgrades for all of them
+            upgrades_handled = sigusr2_count;
+            pthread_mutex_unlock(&running_lock);
+            if (claimed) {
+                server_upgrade(server);
+            }
+        }
+        if (server->draining && !server_drain_step(server, now_ms())) {
+            break;
+        }
+        server_serve_queue(server);
 
-    while (running) {
         // Socket tracking set creation
         FD_ZERO(&sock_set);
-        FD_SET(server->sockfd, &sock_set);
-        max_fd = server->sockfd; // max fd since it's the only fd (for now)
+        FD_ZERO(&write_set);
+        max_fd = -1;
+        for (int l = 0; l < server->num_listeners; l++) {
+            if (server->listeners[l].fd != -1) {
+                FD_SET(server->listeners[l].fd, &sock_set); // closed once a drain stops accepting
+                max_fd = (server->listeners[l].fd > max_fd) ? server->listeners[l].fd : max_fd;
+            }
+        }
+        if (server->upgrade_fd != -1) {
+            FD_SET(server->upgrade_fd, &sock_set);
+            max_fd = (server->upgrade_fd > max_fd) ? server->upgrade_fd : max_fd;
+        }
+        int wake_fds[] = { server->wake.read_fd, signal_notify.read_fd, signal_fd };
+        for (int w = 0; w < 3; w++) {
+            if (wake_fds[w] != -1) {
+                FD_SET(wake_fds[w], &sock_set);
+                max_fd = (wake_fds[w] > max_fd) ? wake_fds[w] : max_fd;
+            }
+        }
+        max_fd = loop_fill(&server->loop, &sock_set, &write_set, max_fd);
         
         // Add client fds to set
         for (int i = 0; i < server->max_clients; i++) {
-            if (server->client_lst[i].client_sock > 0) {
+            // Clients with a queued request are not read again until it has been served,
+            // and clients behind on their responses not until they have caught up.
+            if (server->client_lst[i].client_sock > 0 && output_pending(&server->client_lst[i].out)) {
+                FD_SET(server->client_lst[i].client_sock, &write_set);
+            } else if (server->client_lst[i].client_sock > 0 && !server->client_lst[i].pending) {
                 FD_SET(server->client_lst[i].client_sock, &sock_set);
             }
             if (server->client_lst[i].client_sock > max_fd) {
@@ -265,77 +1540,177 @@ int server_start(Server *server) {
             }
         }
 
-        // Check for activity
-        if (select(max_fd + 1, &sock_set, NULL, NULL, NULL)< 0) {
-            perror("selection failed. Skipping.");
+        // Check for activity, waking up at least once per tick for housekeeping
+        // (or right away when requests are still queued or the loop busy polls), and in time for user timers
+        long timeout_ms = (server->queued > 0 || server_spinning(server))
+                              ? 0 : loop_timeout_ms(&server->loop, now_ms(), SERVER_TICK_MS);
+        struct timeval timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        int ready = select(max_fd + 1, &sock_set, &write_set, NULL, &timeout);
+        int select_errno = errno;
+        if (ready > 0 && server->busy_poll_us > 0) {
+            server->last_active_us = now_us(); // keep spinning while traffic flows
+        }
+
+        long long now = now_ms();
+        if (now - last_tick >= SERVER_TICK_MS) {
+            server_tick(server);
+            last_tick = now;
+        }
+        loop_run_timers(&server->loop, now);
+
+        if (ready < 0) {
+            if (select_errno == EBADF) {
+                loop_drop_closed(&server->loop); // a user descriptor was closed while watched
+            } else if (select_errno != EINTR) { // signals (drain, upgrade) interrupt select()
+                errno = select_errno;
+                perror("selection failed. Skipping.");
+            }
             continue; // skip iteration
         }
+        if (ready == 0) {
+            continue; // timeout: nothing to read
+        }
 
-        // If server socket is flagged, then a client is attempting to connect
-        if (FD_ISSET(server->sockfd, &sock_set)) {
-            struct sockaddr_in client_addr;
-            socklen_t size_struct = sizeof(client_addr);
+        if (FD_ISSET(server->wake.read_fd, &sock_set)) {
+            notify_drain(&server->wake); // requests are read at the top of the loop
+        }
+#ifdef __linux__
+        if (signal_fd != -1 && FD_ISSET(signal_fd, &sock_set)) {
+            server_read_signals(); // counted like the handlers do, waking every loop
+        }
+#endif
+        if (signal_notify.read_fd != -1 && FD_ISSET(signal_notify.read_fd, &sock_set)) {
+            notify_drain(&signal_notify);
+            server_wake_all(); // servers that did not see the wakeup still have to look at the counts
+        }
+        if (server->upgrade_fd != -1 && FD_ISSET(server->upgrade_fd, &sock_set)) {
+            server_upgrade_progress(server);
+        }
+        loop_dispatch(&server->loop, &sock_set, &write_set);
 
-            int new_socket = accept(server->sockfd, (struct sockaddr *)&client_addr, &size_struct);
-            if (new_socket < 0) {
-                perror("accept failed. Skipping.");
+        // Flush unread responses to the clients that can take more.
+        for (int i = 0; i < server->max_clients; i++) {
+            client_t *client = &server->client_lst[i];
+            if (client->client_sock <= 0 || !FD_ISSET(client->client_sock, &write_set)) {
                 continue;
             }
-
-            for (int i = 0; i< server->max_clients; i++) {
-                if (num_clients >= server->max_clients) {
-                    break;
-                }
-                if (server->client_lst[i].client_sock == 0) {
-                    num_clients++;
-                    server->client_lst[i].client_sock = new_socket;
-                    server->client_lst[i].addr = client_addr;
-                    break;
+            ssize_t flushed = output_flush(&client->out, client->client_sock);
+            if (flushed < 0) {
+                remove_client(server, i);
+                continue;
+            }
+            client->write_bytes += flushed;
+            if (!output_pending(&client->out)) {
+                client->write_since_ms = 0; // caught up
+                client->last_active_ms = now;
+                if (client->closing) {
+                    remove_client(server, i);
                 }
             }
         }
 
+        // If a listening socket is flagged, then clients are attempting to connect.
+        // Drain the backlog so waiting clients are queued (and timed) by the server.
+        for (int l = 0; l < server->num_listeners; l++) {
+            if (server->listeners[l].fd != -1 && FD_ISSET(server->listeners[l].fd, &sock_set)) {
+                for (int n = 0; n < server->max_clients && accept_client(server, l, now); n++);
+            }
+        }
+
         for (int i = 0; i < server->max_clients; i++) {
            if (FD_ISSET(server->client_lst[i].client_sock, &sock_set)) {
-                char buffer[BUFFER_SIZE];
-                int chars_read = read(server->client_lst[i].client_sock, buffer, sizeof(buffer) - 1);
+                client_t *client = &server->client_lst[i];
+                char *buffer = client->buffer;
+                if (client->read_len == 0 && client->served > 0) {
+                    client->read_since_ms = now; // next request on a kept-alive connection
+                }
+                int chars_read = read(client->client_sock, buffer + client->read_len,
+                                      BUFFER_SIZE - 1 - client->read_len);
                 if (chars_read == 0) {
                     // Client has been disconnected. Remove from client list.
                     remove_client(server, i);
-                    num_clients--;
                 } else if (chars_read < 0) {
                     if (errno == EINTR) {
                         // Interrupted by a signal, safe to retry. Read will be tried again.
                         continue;
                     } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
                         // Non-blocking socket. no data yet, so handle later.
-                        break;
+                        continue;
                     } else {
                         // Other errors: disconnect client
                         perror("read failed. Skipping");
                         remove_client(server, i);
-                        num_clients--;
                         break;
                     }
 
                 } else {
                     // Read was successful. process data!
-                    if (!process_header(buffer, server->client_lst[i].client_sock, &server->router_lst)) {
-                        // Route not found or handler failed
-                        const char *not_found = "HTTP/1.1 404 Not Found\r\n"
-                                                "Content-Length: 0\r\n"
-                                                "Connection: close\r\n\r\n";
-                        write(server->client_lst[i].client_sock, not_found, strlen(not_found));
-
+                    client->read_len += chars_read;
+                    buffer[client->read_len] = '\0';
+                    if (!strstr(buffer, "\r\n\r\n")) {
+                        if (client->read_len == BUFFER_SIZE - 1) {
+                            // Header block does not fit in the read buffer.
+                            send_error(client->client_sock, RESPONSE_HEADER_TOO_LARGE);
+                            remove_client(server, i);
+                        }
+                        continue; // wait for the rest of the header block
+                    }
+                    if (server->limiter.slots && client->has_ip
+                        && !ratelimit_request(&server->limiter, &client->ip, now)) {
+                        // Over its request rate: answer without running a handler.
+                        send_error(server->client_lst[i].client_sock, RESPONSE_TOO_MANY_REQUESTS);
+                        remove_client(server, i);
+                        continue;
+                    }
+                    // Classify by route; a share of the concurrency limit is kept for critical routes.
+                    int route = match_route(&server->router_lst, buffer);
+                    Router *router = (route >= 0) ? &server->router_lst.items[route] : NULL;
+                    if (router && router->max_in_flight > 0 && router->in_flight >= router->max_in_flight) {
+                        // The route's bulkhead is full: fail fast instead of queueing.
+                        router->rejected++;
+                        send_error(server->client_lst[i].client_sock, RESPONSE_UNAVAILABLE);
+                        remove_client(server, i);
+                        continue;
+                    }
+                    server->client_lst[i].priority = router ? router->priority : PRIORITY_NORMAL;
+                    int reserved = 0;
+                    if (server->client_lst[i].priority != PRIORITY_CRITICAL) {
+                        reserved = (int)(server->concurrency.limit * SERVER_RESERVED_PERCENT / 100) + 1;
+                    }
+                    if (server->concurrency.max_limit > 0 && !concurrency_acquire(&server->concurrency, reserved)) {
+                        // Over the adaptive limit: reject now rather than queue behind the others.
+                        send_error(server->client_lst[i].client_sock, RESPONSE_UNAVAILABLE);
                         remove_client(server, i);
+                        continue;
+                    }
+                    // Queue the request; it is served at the top of the next pass.
+                    server->client_lst[i].request_len = client->read_len;
+                    server->client_lst[i].read_len = 0;
+                    server->client_lst[i].route = route;
+                    if (router) {
+                        router->in_flight++;
                     }
+                    queue_push(server, i);
+                    server->client_lst[i].deadline_us = request_deadline(server, router, buffer,
+                                                                         server->client_lst[i].arrival_us);
                     continue;
                 }
            }
         }
+
     }
 
     // Cleanup when server stops
+    server_unregister(server);
+    loop_set_current(NULL);
+    loop_close(&server->loop);
+    if (loop_masked) {
+        pthread_sigmask(SIG_SETMASK, &loop_saved_mask, NULL);
+        loop_masked = 0;
+    }
+    if (realtime) {
+        pthread_setschedparam(pthread_self(), old_policy, &old_param);
+    }
     for (size_t i = 0; i < server->max_clients; i++) {
         if (server->client_lst[i].client_sock > 0) {
             remove_client(server, i);
@@ -362,9 +1737,13 @@ int server_start(Server *server) {
  */
 int server_add_route(Server *server, method_t method, path_t path, HandlerFunc handler) {
     Router new_router;
+    memset(&new_router, 0, sizeof(Router));
     new_router.method = method;
     new_router.path = path;
     new_router.handler = handler;
+    new_router.compress_level = -1; // inherit server default
+    new_router.cache_ttl_ms = 0;
+    new_router.priority = PRIORITY_NORMAL;
 
     return add_route(&server->router_lst, new_router);
 }
@@ -389,5 +1768,425 @@ int server_remove_route(Server *server, method_t method, path_t path) {
     temp_router.path = path;
     temp_router.handler = NULL;
 
+    int index = find_route(&server->router_lst, temp_router);
+    if (index == -1) {
+        return 0;
+    }
+    // Pending requests refer to routes by index: follow the compaction.
+    for (int i = 0; i < server->max_clients; i++) {
+        client_t *client = &server->client_lst[i];
+        if (!client->pending || client->route < index) {
+            continue;
+        }
+        client->route = (client->route == index) ? -1 : client->route - 1;
+    }
     return remove_route(&server->router_lst, temp_router);
 }
+
+
+/**
+ * @brief Looks up a registered route by method and path.
+ *
+ * @return Pointer to the route inside the server's RouterList, or NULL if not registered.
+ */
+static Router *server_get_route(Server *server, method_t method, path_t path) {
+    Router temp_router;
+    temp_router.method = method;
+    temp_router.path = path;
+    temp_router.handler = NULL;
+
+    int index = find_route(&server->router_lst, temp_router);
+    return (index == -1) ? NULL : &server->router_lst.items[index];
+}
+
+
+/**
+ * @brief Configures on-the-fly response compression for the whole server.
+ *
+ * @param server   Pointer to the Server instance.
+ * @param level    Default zlib level (1-9), or 0 to disable compression.
+ * @param min_size Minimum body size in bytes worth compressing.
+ */
+void server_set_compression(Server *server, int level, size_t min_size) {
+    if (level < 0) level = 0;
+    if (level > 9) level = 9;
+    server->compress_level = level;
+    server->compress_min_size = min_size;
+}
+
+
+/**
+ * @brief Overrides the compression level of a single route.
+ *
+ * @return 1 on success, 0 if the route does not exist or the level is invalid.
+ */
+int server_set_route_compression(Server *server, method_t method, path_t path, int level) {
+    Router *route = server_get_route(server, method, path);
+    if (!route || level < -1 || level > 9) {
+        return 0;
+    }
+    route->compress_level = level;
+    return 1;
+}
+
+
+/**
+ * @brief Enables response caching for a route.
+ *
+ * @return 1 on success, 0 if the route does not exist or the TTL is negative.
+ */
+int server_set_route_cache(Server *server, method_t method, path_t path, long ttl_ms) {
+    Router *route = server_get_route(server, method, path);
+    if (!route || ttl_ms < 0) {
+        return 0;
+    }
+    route->cache_ttl_ms = ttl_ms;
+    return 1;
+}
+
+
+/**
+ * @brief Sets the priority class of a route.
+ *
+ * @return 1 on success, 0 if the route does not exist or the class is invalid.
+ */
+int server_set_route_priority(Server *server, method_t method, path_t path, priority_t priority) {
+    Router *route = server_get_route(server, method, path);
+    if (!route || priority < PRIORITY_CRITICAL || priority >= PRIORITY_COUNT) {
+        return 0;
+    }
+    route->priority = priority;
+    return 1;
+}
+
+
+/**
+ * @brief Starts a graceful drain of the server.
+ *
+ * Only flags the drain, which the server's own loop then starts.
+ *
+ * @param server Pointer to the Server instance.
+ */
+void server_drain(Server *server) {
+    pthread_mutex_lock(&running_lock); // the loop may be closing its self-pipe
+    atomic_store(&server->drain_pending, 1);
+    server_wake(server);
+    pthread_mutex_unlock(&running_lock);
+}
+
+
+/**
+ * @brief Stops a running server.
+ *
+ * @return 1 if the server was running, 0 otherwise.
+ */
+int server_stop(Server *server) {
+    pthread_mutex_lock(&running_lock);
+    int found = 0;
+    for (int i = 0; i < num_running; i++) {
+        if (running_servers[i] == server) {
+            atomic_store(&server->running, 0);
+            server_wake(server);
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&running_lock);
+    return found;
+}
+
+
+/**
+ * @brief Hands the server over to a new process running the binary on disk.
+ *
+ * @return 1 if the new process was started, 0 otherwise.
+ */
+int server_upgrade(Server *server) {
+    if (server->draining) {
+        return 0;
+    }
+
+    // The new process takes over the listeners of every server running here.
+    pthread_mutex_lock(&running_lock);
+    Server *self[1] = { server };
+    Server **servers = num_running > 0 ? running_servers : self;
+    int num_servers = num_running > 0 ? num_running : 1;
+    int fds[SERVER_MAX_RUNNING * SERVER_MAX_LISTENERS];
+    int count = 0;
+    int busy = 0;
+    for (int s = 0; s < num_servers; s++) {
+        busy |= servers[s]->upgrade_fd != -1;
+        for (int i = 0; i < servers[s]->num_listeners; i++) {
+            if (servers[s]->listeners[i].fd != -1) {
+                fds[count++] = servers[s]->listeners[i].fd;
+            }
+        }
+    }
+    if (!busy && count > 0) {
+        server->upgrade_fd = upgrade_spawn(fds, count, &server->upgrade_pid);
+    }
+    pthread_mutex_unlock(&running_lock);
+    return !busy && server->upgrade_fd != -1;
+}
+
+
+/**
+ * @brief Reports this process ready to the one it takes over from.
+ */
+void server_upgrade_ready(void) {
+    upgrade_notify_ready(1);
+}
+
+
+/**
+ * @brief Tells whether the server wants new traffic.
+ *
+ * @return 1 if ready, 0 otherwise.
+ */
+int server_is_ready(const Server *server) {
+    return server->ready && !atomic_load(&server->drain_pending);
+}
+
+
+/**
+ * @brief Sets the timing of graceful drains.
+ */
+void server_set_drain(Server *server, long delay_ms, long timeout_ms) {
+    server->drain_delay_ms = (delay_ms > 0) ? delay_ms : 0;
+    server->drain_timeout_ms = (timeout_ms > 0) ? timeout_ms : 0;
+}
+
+
+/**
+ * @brief Makes the loop busy poll for a while after activity before blocking.
+ *
+ * @return 1 on success, 0 if an argument is out of range.
+ */
+int server_set_busy_poll(Server *server, long spin_us, int priority) {
+    if (spin_us < 0 || (priority != 0 && (priority < sched_get_priority_min(SCHED_FIFO) ||
+                                          priority > sched_get_priority_max(SCHED_FIFO)))) {
+        return 0;
+    }
+    server->busy_poll_us = spin_us;
+    server->busy_poll_priority = priority;
+    return 1;
+}
+
+
+/**
+ * @brief Sets the slow-client protections of the server.
+ *
+ * @param server Pointer to the Server instance.
+ * @param limits The limits (a window of 0 keeps the default).
+ */
+void server_set_transfer_limits(Server *server, const TransferLimits *limits) {
+    server->transfer = *limits;
+    if (server->transfer.window_ms <= 0) {
+        server->transfer.window_ms = SERVER_RATE_WINDOW_MS;
+    }
+}
+
+
+/**
+ * @brief Sets the default deadline of requests.
+ *
+ * @param server     Pointer to the Server instance.
+ * @param timeout_ms The deadline in milliseconds, or 0 for none.
+ */
+void server_set_request_timeout(Server *server, long timeout_ms) {
+    server->timeout_ms = (timeout_ms > 0) ? timeout_ms : 0;
+}
+
+
+/**
+ * @brief Overrides the request deadline of a single route.
+ *
+ * @return 1 on success, 0 if the route does not exist or the timeout is negative.
+ */
+int server_set_route_timeout(Server *server, method_t method, path_t path, long timeout_ms) {
+    Router *route = server_get_route(server, method, path);
+    if (!route || timeout_ms < 0) {
+        return 0;
+    }
+    route->timeout_ms = timeout_ms;
+    return 1;
+}
+
+
+/**
+ * @brief Caps the number of requests a route may have in flight.
+ *
+ * @return 1 on success, 0 if the route does not exist or the cap is negative.
+ */
+int server_set_route_max_in_flight(Server *server, method_t method, path_t path, int max_in_flight) {
+    Router *route = server_get_route(server, method, path);
+    if (!route || max_in_flight < 0) {
+        return 0;
+    }
+    route->max_in_flight = max_in_flight;
+    return 1;
+}
+
+
+/**
+ * @brief Reads the bulkhead counters of a route.
+ *
+ * @return 1 on success, 0 if the route does not exist.
+ */
+int server_route_stats(Server *server, method_t method, path_t path, RouteStats *stats) {
+    Router *route = server_get_route(server, method, path);
+    if (!route) {
+        return 0;
+    }
+    stats->max_in_flight = route->max_in_flight;
+    stats->in_flight = route->in_flight;
+    stats->rejected = route->rejected;
+    return 1;
+}
+
+
+/**
+ * @brief Sets the size limits of the server's response cache.
+ *
+ * The memfd threshold applies to subsequent stores. Lowering `max_bytes` evicts
+ * entries right away; under memory pressure only a fraction of it is used.
+ *
+ * @param server          Pointer to the Server instance.
+ * @param max_bytes       Upper bound on the total size of cached bodies.
+ * @param memfd_threshold Bodies at least this large are kept in a sealed memfd. 0 disables.
+ */
+void server_set_cache_limits(Server *server, size_t max_bytes, size_t memfd_threshold) {
+    if (server->region.base) {
+        return; // static budget mode keeps caching disabled
+    }
+    server->cache.max_bytes = max_bytes;
+    server->cache.memfd_threshold = memfd_threshold;
+    cache_set_limit(&server->cache, pressure_cache_limit(max_bytes, server->pressure.level));
+}
+
+
+/**
+ * @brief Returns the memory pressure level the server currently applies.
+ *
+ * @param server Pointer to the Server instance.
+ * @return The pressure level.
+ */
+pressure_level_t server_memory_pressure(const Server *server) {
+    return server->pressure.level;
+}
+
+
+/**
+ * @brief Enables, changes or disables per-client connection caps and request rate limits.
+ *
+ * @param server Pointer to the Server instance.
+ * @param limits The limits, or NULL to disable rate limiting.
+ * @return 1 on success, 0 on allocation failure.
+ */
+int server_set_rate_limits(Server *server, const RateLimits *limits) {
+    ratelimit_free(&server->limiter);
+    if (!limits) {
+        return 1;
+    }
+    return ratelimit_init(&server->limiter, server->max_clients, limits);
+}
+
+
+/**
+ * @brief Enables or disables the adaptive limit on requests in flight.
+ *
+ * @param server    Pointer to the Server instance.
+ * @param min_limit Lower bound of the limit.
+ * @param max_limit Upper bound of the limit (and starting point), or 0 to disable.
+ */
+void server_set_adaptive_concurrency(Server *server, int min_limit, int max_limit) {
+    if (max_limit <= 0) {
+        memset(&server->concurrency, 0, sizeof(ConcurrencyLimit));
+        return;
+    }
+    concurrency_init(&server->concurrency, min_limit, max_limit);
+}
+
+
+/**
+ * @brief Returns the current adaptive concurrency limit.
+ *
+ * @param server Pointer to the Server instance.
+ * @return The limit, or 0 if adaptive concurrency is disabled.
+ */
+int server_concurrency_limit(const Server *server) {
+    return server->concurrency.max_limit > 0 ? (int)server->concurrency.limit : 0;
+}
+
+
+/**
+ * @brief Enables or disables shedding of requests that waited too long in the queue.
+ *
+ * @param server      Pointer to the Server instance.
+ * @param target_us   Acceptable standing queue delay in microseconds, or 0 to disable.
+ * @param interval_us Observation interval in microseconds.
+ */
+void server_set_queue_shedding(Server *server, long long target_us, long long interval_us) {
+    if (target_us <= 0) {
+        memset(&server->codel, 0, sizeof(CoDel));
+        return;
+    }
+    codel_init(&server->codel, target_us, interval_us > 0 ? interval_us : CODEL_DEFAULT_INTERVAL_US);
+}
+
+
+/**
+ * @brief Makes the server listen on one more endpoint.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+int server_listen(Server *server, const char *endpoint) {
+    struct sockaddr_storage addr;
+    socklen_t len;
+    if (!listener_parse(endpoint, &addr, &len)) {
+        fprintf(stderr, "Invalid endpoint %s.\n", endpoint);
+        return 0;
+    }
+    if (server->num_listeners == SERVER_MAX_LISTENERS) {
+        fprintf(stderr, "Too many listeners. %s not added.\n", endpoint);
+        return 0;
+    }
+
+    const char *origin = "inherited";
+    int fd = upgrade_inherited_listener((struct sockaddr *)&addr, len);
+    if (fd == -1) {
+        origin = "passed by the supervisor";
+        fd = activation_listener((struct sockaddr *)&addr, len);
+    }
+    if (fd == -1) {
+        origin = NULL;
+        fd = listener_open((struct sockaddr *)&addr, len);
+    }
+    if (fd == -1) {
+        fprintf(stderr, "Cannot listen on %s.\n", endpoint);
+        return 0;
+    }
+
+    Listener *listener = &server->listeners[server->num_listeners++];
+    memset(listener, 0, sizeof(*listener));
+    listener->fd = fd;
+    listener_name(fd, listener->name, LISTENER_NAME_SIZE);
+    if (origin) {
+        fprintf(stderr, "Using the listening socket %s on %s.\n", origin, listener->name);
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Reads the counters of a listener.
+ *
+ * @return 1 on success, 0 if there is no such listener.
+ */
+int server_listener_stats(const Server *server, int index, Listener *stats) {
+    if (index < 0 || index >= server->num_listeners) {
+        return 0;
+    }
+    *stats = server->listeners[index];
+    return 1;
+}
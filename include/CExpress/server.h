@@ -24,14 +24,64 @@
 #include <netinet/in.h>
 #include <signal.h> // Necessary for handling signals
 #include <errno.h>    // defines errno, EINTR, EAGAIN, EWOULDBLOCK
+#include <stdatomic.h>
 
 #include "utils.h"
 #include "routers.h"
+#include "compress.h"
+#include "cache.h"
+#include "pool.h"
+#include "region.h"
+#include "memory.h"
+#include "alloc.h"
+#include "pressure.h"
+#include "ratelimit.h"
+#include "concurrency.h"
+#include "codel.h"
+#include "output.h"
+#include "upgrade.h"
+#include "activation.h"
+#include "listener.h"
+#include "loop.h"
+#include "notify.h"
 
 // User defined constants
 #define BUFFER_SIZE 1024
+#define SERVER_FD_RESERVE 32   // descriptors kept for the listener, stdio, memfds and files
+#define SERVER_EVICT_PERCENT 90   // client table occupancy at which idle connections are evicted
+#define SERVER_EVICT_MIN_IDLE_MS 1000   // keep-alive connections idle for less than this are never evicted
+#define SERVER_SERVE_BUDGET_US 20000   // time spent serving queued requests before polling sockets again
+#define SERVER_WEIGHT_HIGH 8   // share of PRIORITY_HIGH requests when classes compete
+#define SERVER_WEIGHT_NORMAL 4   // share of PRIORITY_NORMAL requests when classes compete
+#define SERVER_WEIGHT_BULK 1   // share of PRIORITY_BULK requests when classes compete
+#define SERVER_RESERVED_PERCENT 10   // share of the concurrency limit only PRIORITY_CRITICAL requests may use
+#define SERVER_TIMEOUT_HEADER "X-Request-Timeout"   // request header carrying the client's own budget in ms
+#define SERVER_MAX_OUTPUT (1 << 20)   // default bytes of responses a connection may leave unread
+#define SERVER_RATE_WINDOW_MS 10000   // default window over which minimum transfer rates are measured
+#define SERVER_DRAIN_TIMEOUT_MS 30000   // default time in-flight work gets to finish during a drain
+#define SERVER_TICK_MS 1000   // upper bound on how long select() blocks before housekeeping runs
+#define SERVER_MAX_LISTENERS 8   // endpoints a server listens on, the one given to server_init() included
+#define SERVER_MAX_RUNNING 16   // servers that may run at once in one process
 #define LOCALHOST_IP "127.0.0.1"
 
+// Preformatted error responses (sent without allocating)
+#define RESPONSE_NOT_FOUND "HTTP/1.1 404 Not Found\r\n" \
+                           "Content-Length: 0\r\n" \
+                           "Connection: close\r\n\r\n"
+#define RESPONSE_HEADER_TOO_LARGE "HTTP/1.1 431 Request Header Fields Too Large\r\n" \
+                                  "Content-Length: 0\r\n" \
+                                  "Connection: close\r\n\r\n"
+#define RESPONSE_UNAVAILABLE "HTTP/1.1 503 Service Unavailable\r\n" \
+                             "Content-Length: 0\r\n" \
+                             "Connection: close\r\n\r\n"
+#define RESPONSE_GATEWAY_TIMEOUT "HTTP/1.1 504 Gateway Timeout\r\n" \
+                                 "Content-Length: 0\r\n" \
+                                 "Connection: close\r\n\r\n"
+#define RESPONSE_TOO_MANY_REQUESTS "HTTP/1.1 429 Too Many Requests\r\n" \
+                                   "Retry-After: 1\r\n" \
+                                   "Content-Length: 0\r\n" \
+                                   "Connection: close\r\n\r\n"
+
 
 /**
  * @enum Mode
@@ -44,13 +94,71 @@
 typedef enum { DEV, PROD } Mode;
 
 
+/**
+ * @struct RouteStats
+ * @brief Bulkhead counters of a route, see server_route_stats().
+ */
+typedef struct {
+    int max_in_flight;        // bulkhead limit, 0 for no limit
+    int in_flight;            // requests admitted and not yet answered
+    size_t rejected;          // requests turned away by the bulkhead
+} RouteStats;
+
+
+/**
+ * @struct TransferLimits
+ * @brief Protection against clients that send or read too slowly, see server_set_transfer_limits().
+ */
+typedef struct {
+    size_t max_output;        // bytes of responses a connection may leave unread before it is dropped (0: writes wait instead)
+    size_t min_upload_rate;   // bytes per second a client must send its request at, 0 disables
+    size_t min_download_rate; // bytes per second a client must read its responses at, 0 disables
+    long window_ms;           // rates are measured over windows of this length
+} TransferLimits;
+
+
+/**
+ * @struct MemoryBudget
+ * @brief Sizing of a server running in static memory budget mode.
+ *
+ * See server_init_static().
+ */
+typedef struct {
+    size_t max_routes;        // capacity of the route table
+    size_t arena_bytes;       // memory available to a single request (parsing, handler, response)
+} MemoryBudget;
+
+
 /**
  * @struct client_t
  * @brief Represents a connected client.
  */
 typedef struct {
     int client_sock;          // client socket
-    struct sockaddr_in addr;  // client address
+    struct sockaddr_storage addr; // client address
+    RateAddr ip;              // address rate limits apply to
+    int has_ip;               // 1 for TCP peers, 0 for Unix socket peers (exempt from rate limits)
+    int rate_counted;         // RATELIMIT_COUNTED_* entries the connection is counted in
+    int listener;             // index of the listener that accepted the connection
+    char *buffer;             // pooled read buffer of BUFFER_SIZE bytes
+    long long last_active_ms; // monotonic time of the last accept or response
+    int served;               // number of responses sent on this connection
+    int lru_prev;             // less recently active client slot, -1 at the head
+    int lru_next;             // more recently active client slot, -1 at the tail
+    int pending;              // 1 if a request was read and waits in the queue
+    size_t request_len;       // length of the pending request in `buffer`
+    long long arrival_us;     // monotonic time (us) the pending request was read
+    int queue_prev;           // slot queued before this one, -1 at the head
+    int queue_next;           // slot queued after this one, -1 at the tail
+    priority_t priority;      // class of the pending request
+    int route;                // route index of the pending request, -1 if none matched
+    long long deadline_us;    // monotonic time (us) the pending request expires, 0 for none
+    size_t read_len;          // bytes of the next request read so far
+    long long read_since_ms;  // monotonic time the next request started arriving
+    Output out;               // response bytes the client has not read yet
+    long long write_since_ms; // start of the current download rate window, 0 while nothing is unread
+    size_t write_bytes;       // bytes the client read during the current download rate window
+    int closing;              // 1 to close the connection once its unread output is flushed
 } client_t;
 
 
@@ -58,15 +166,57 @@ typedef struct {
  * @struct Server
  * @brief Represents the TCP server configuration and state.
  */
-typedef struct {
-    int sockfd;               // server socket
-    struct sockaddr_in addr;  // server address
+typedef struct Server {
+    Listener listeners[SERVER_MAX_LISTENERS]; // listening sockets, the one of server_init() first
+    int num_listeners;        // entries in `listeners`
+    struct sockaddr_in addr;  // address of the first listener
     int port;                 // server port
     Mode mode;
     int max_clients;          // server max amount of concurrent clients
     client_t *client_lst;     // list of connected clients
     int backlog;              // max number of partially completed connections (queue for clients)
     RouterList router_lst;    // global routing list
+    int compress_level;       // default zlib level for routes (0 disables compression)
+    size_t compress_min_size; // bodies smaller than this are never compressed
+    ResponseCache cache;      // cached responses of routes with a cache TTL
+    Arena arena;              // per-request memory, reset after every response
+    Region region;            // backing memory in static budget mode (base is NULL otherwise)
+    PressureMonitor pressure; // memory pressure sampled from the event loop
+    int lru_head;             // least recently active client slot, -1 if none
+    int lru_tail;             // most recently active client slot, -1 if none
+    int fd_limit;             // highest usable descriptor + 1 (soft RLIMIT_NOFILE, capped at FD_SETSIZE)
+    size_t evicted;           // idle keep-alive connections closed to make room
+    RateLimiter limiter;      // per-client caps and buckets (slots is NULL when disabled)
+    ConcurrencyLimit concurrency; // adaptive in-flight limit (max_limit is 0 when disabled)
+    int num_clients;          // connected clients
+    int queue_head[PRIORITY_COUNT]; // oldest pending request's slot per class, -1 if none
+    int queue_tail[PRIORITY_COUNT]; // newest pending request's slot per class, -1 if none
+    int queue_credit[PRIORITY_COUNT]; // weighted round robin credit per class
+    int queued;               // pending requests in all classes
+    CoDel codel;              // queue overload state (target_us is 0 when shedding is disabled)
+    long timeout_ms;          // default request deadline, 0 for none
+    size_t expired;           // queued requests dropped because their deadline passed
+    size_t timed_out;         // requests answered 504 because their handler overran the deadline
+    TransferLimits transfer;  // output cap and minimum transfer rates
+    size_t slow_closed;       // connections dropped for transferring too slowly or leaving too much unread
+    int ready;                // 1 while the server wants new traffic (see server_is_ready())
+    int draining;             // 1 once a graceful drain has started
+    long long drain_start_ms; // monotonic time the drain started
+    long drain_delay_ms;      // new connections are still accepted this long into a drain
+    long drain_timeout_ms;    // in-flight work gets this long once accepting stopped
+    int upgrade_fd;           // readiness pipe of the process taking over, -1 if no upgrade is under way
+    pid_t upgrade_pid;        // process taking over
+    atomic_int running;       // 1 while server_start() loops, cleared by server_stop()
+    atomic_int drain_pending; // set by server_drain(), possibly from another thread
+    Notify wake;              // interrupts select() for server_stop(), server_drain() and cx_loop_post()
+    sig_atomic_t seen_sigint; // SIGINTs this server has acted on
+    sig_atomic_t seen_sigterm; // SIGTERMs this server has acted on
+    Loop loop;                // user descriptors and timers (see cx_loop_add_fd())
+    LoopPost posts[LOOP_MAX_POSTS]; // callbacks other threads posted (see cx_loop_post())
+    int num_posts;            // entries in `posts`, guarded by the running servers lock
+    long busy_poll_us;        // the loop spins this long after activity before blocking, 0 to always block
+    int busy_poll_priority;   // SCHED_FIFO priority of the loop thread while busy polling, 0 to keep its policy
+    long long last_active_us; // monotonic time select() last found a descriptor ready
 } Server;
 
 
@@ -90,6 +240,84 @@ typedef struct {
 Server *server_init(int port, int max_clients, int backlog, Mode mode);
 
 
+/**
+ * @brief Initializes a server on a socket that is already bound.
+ *
+ * For supervisors and launchers that open the port themselves. The socket may
+ * already be listening; the port is read from it. On success the server owns
+ * the socket and server_free() closes it.
+ *
+ * @param fd An IPv4 TCP socket, bound and possibly listening.
+ * @param max_clients Maximum number of concurrent client connections allowed.
+ * @param backlog Maximum number of pending connections in the listen queue.
+ *
+ * @return Pointer to a dynamically allocated Server struct on success, or NULL on failure.
+ *
+ * @note server_init() itself picks up sockets passed through socket activation
+ *       (LISTEN_FDS/LISTEN_PID, see activation.h) for its port.
+ */
+Server *server_init_from_fd(int fd, int max_clients, int backlog);
+
+
+/**
+ * @brief Makes the server listen on one more endpoint.
+ *
+ * Every listener feeds the same routes and event loop. Call before server_start().
+ * The endpoint is `host:port` for IPv4, `[host]:port` for IPv6, `unix:/path`
+ * for a Unix domain socket, or `unix:@name` for one in the abstract namespace
+ * (see listener.h). Sockets handed down by an upgrade or passed by a supervisor
+ * are used when one is bound to the endpoint.
+ *
+ * @param server   Pointer to the Server instance.
+ * @param endpoint The endpoint.
+ *
+ * @return 1 on success, 0 if the endpoint is malformed, cannot be bound, or
+ *         SERVER_MAX_LISTENERS is reached.
+ *
+ * @note Rate limits apply to IPv4 and IPv6 clients. Unix socket peers are exempt:
+ *       they are local processes, and have no address to key them on.
+ */
+int server_listen(Server *server, const char *endpoint);
+
+
+/**
+ * @brief Reads the counters of a listener.
+ *
+ * @param server Pointer to the Server instance.
+ * @param index  Index of the listener, 0 for the one of server_init(), then in
+ *               server_listen() order.
+ * @param stats  Filled with the listener's endpoint and counters.
+ *
+ * @return 1 on success, 0 if there is no such listener.
+ */
+int server_listener_stats(const Server *server, int index, Listener *stats);
+
+
+/**
+ * @brief Initializes a server with a fixed memory budget and no allocation after startup.
+ *
+ * All connection slots, read buffers, the route table and the request arena are
+ * carved from a single region mapped here. Once server_start() runs, the framework
+ * does not allocate: a request that would exceed its arena receives a preformatted
+ * 503, connections beyond `max_clients` receive a 503, oversized request headers a
+ * 431, and server_add_route() fails once `max_routes` routes exist. Response
+ * caching is disabled in this mode.
+ *
+ * @param port The TCP port number the server should bind to.
+ * @param max_clients Maximum number of concurrent client connections allowed.
+ * @param backlog Maximum number of pending connections in the listen queue.
+ * @param mode Server binding mode (DEV or PROD).
+ * @param budget Sizes of the route table and of the per-request arena.
+ *
+ * @return Pointer to the Server on success, or NULL on failure.
+ *
+ * @note Handlers should build their bodies with cx_alloc() to stay within the budget.
+ *       The region follows the huge page and prefault options set with
+ *       cx_set_memory_options() beforehand. Use server_free() to release the region.
+ */
+Server *server_init_static(int port, int max_clients, int backlog, Mode mode, const MemoryBudget *budget);
+
+
 /**
  * @brief Frees all server resources and shuts down the server.
  *
@@ -104,14 +332,80 @@ void server_free(Server *server);
  * @brief Starts the server and begins accepting client connections.
  *
  * This function binds the socket, listens for incoming connections,
- * and handles client requests in a loop.
+ * and handles client requests in a loop. If memory options are set (see
+ * cx_set_memory_options()), pool slabs are prefaulted and memory is locked first,
+ * and a report of resident and pinned memory is printed.
+ *
+ * SIGINT stops the server at once. SIGTERM and SIGHUP start a graceful drain
+ * instead (see server_drain()), after which the server stops on its own. SIGUSR2
+ * starts a binary upgrade (see server_upgrade()). Signals apply to every
+ * server running in the process. On Linux the loop thread blocks them and reads
+ * them from a signalfd, so they arrive as ordinary loop events.
+ *
+ * Child processes inherit the blocked mask. Children started with fork() from
+ * the loop thread get the thread's previous mask back automatically. system(),
+ * popen() and posix_spawn() may bypass fork handlers: see server_child_signal_mask().
+ *
+ * Several servers may run at once, each on its own thread with its own loop,
+ * routes and limits (up to SERVER_MAX_RUNNING). Create all of them before
+ * starting any, so a binary upgrade finds every listener.
  *
  * @param server Pointer to the initialized Server struct.
  * @return 0 on successful start, or -1 on error.
+ *
+ * @note The server is freed when this returns.
  */
 int server_start(Server *server);
 
 
+/**
+ * @brief Stops a running server, as SIGINT does for all of them.
+ *
+ * Thread-safe: meant to be called from another thread than the one running
+ * server_start(), which closes the connections, frees the server and returns
+ * shortly after.
+ *
+ * @param server Pointer to the Server instance.
+ * @return 1 if the server was running, 0 if it was not (or has already stopped).
+ */
+int server_stop(Server *server);
+
+
+/**
+ * @brief Runs a callback on a running server's loop thread.
+ *
+ * Thread-safe: the way for other threads to hand work to the loop, for example
+ * to touch descriptors watched with cx_loop_add_fd(). The loop wakes at once
+ * and runs posted callbacks in order, before serving queued requests.
+ *
+ * @param server   Pointer to the Server instance.
+ * @param callback Called once, on the loop thread.
+ * @param ctx      Passed to the callback.
+ * @return 1 if the callback was queued, 0 if the server is not running or
+ *         LOOP_MAX_POSTS callbacks are already waiting.
+ */
+int cx_loop_post(Server *server, LoopTimerCallback callback, void *ctx);
+
+
+/**
+ * @brief Gives the signal mask processes started from the calling thread should have.
+ *
+ * On a loop thread this is the mask the thread had before server_start()
+ * blocked SIGINT, SIGTERM, SIGHUP and SIGUSR2; elsewhere it is the current one.
+ * Pass it to posix_spawnattr_setsigmask(), or install it with pthread_sigmask()
+ * around system() and popen() (the handlers take the signals meanwhile):
+ *
+ *     sigset_t child, saved;
+ *     server_child_signal_mask(&child);
+ *     pthread_sigmask(SIG_SETMASK, &child, &saved);
+ *     system("reindex.sh");
+ *     pthread_sigmask(SIG_SETMASK, &saved, NULL);
+ *
+ * @param mask Receives the mask.
+ */
+void server_child_signal_mask(sigset_t *mask);
+
+
 /**
  * @brief Registers a new route in the server's RouterList for handling HTTP requests.
  *
@@ -144,3 +438,314 @@ int server_add_route(Server *server, method_t method, path_t path, HandlerFunc h
  */
 int server_remove_route(Server *server, method_t method, path_t path);
 
+
+/**
+ * @brief Configures on-the-fly response compression for the whole server.
+ *
+ * Responses are compressed with gzip or deflate when the client's Accept-Encoding
+ * allows it and the body is at least `min_size` bytes long. Routes may override
+ * the level with server_set_route_compression().
+ *
+ * @param server   Pointer to the Server instance.
+ * @param level    Default zlib level (1-9), or 0 to disable compression.
+ * @param min_size Minimum body size in bytes worth compressing.
+ */
+void server_set_compression(Server *server, int level, size_t min_size);
+
+
+/**
+ * @brief Overrides the compression level of a single route.
+ *
+ * @param server Pointer to the Server instance.
+ * @param method The HTTP method of the route.
+ * @param path   The URL path of the route.
+ * @param level  zlib level (1-9), 0 to disable compression, or -1 to inherit the server default.
+ *
+ * @return 1 on success, 0 if the route does not exist or the level is invalid.
+ */
+int server_set_route_compression(Server *server, method_t method, path_t path, int level);
+
+
+/**
+ * @brief Enables response caching for a route.
+ *
+ * The handler's output is stored for `ttl_ms` milliseconds and served to every
+ * matching request in the meantime, together with compressed variants that are
+ * computed once per entry. Only use this for handlers whose output does not
+ * depend on the request.
+ *
+ * @param server Pointer to the Server instance.
+ * @param method The HTTP method of the route.
+ * @param path   The URL path of the route.
+ * @param ttl_ms Time-to-live of cached responses in milliseconds, or 0 to disable caching.
+ *
+ * @return 1 on success, 0 if the route does not exist or the TTL is negative.
+ */
+int server_set_route_cache(Server *server, method_t method, path_t path, long ttl_ms);
+
+
+/**
+ * @brief Sets the scheduling class of a route.
+ *
+ * Queued requests are served by class: PRIORITY_CRITICAL first, the others by
+ * weighted round robin (SERVER_WEIGHT_HIGH, SERVER_WEIGHT_NORMAL,
+ * SERVER_WEIGHT_BULK), so bulk traffic cannot starve interactive routes.
+ * Critical requests are never shed and may use the share of the adaptive
+ * concurrency limit reserved for them (SERVER_RESERVED_PERCENT), so health
+ * checks keep succeeding under overload. Routes are PRIORITY_NORMAL by default.
+ *
+ * @param server   Pointer to the Server instance.
+ * @param method   The HTTP method of the route.
+ * @param path     The URL path of the route.
+ * @param priority The class.
+ *
+ * @return 1 on success, 0 if the route does not exist or the class is invalid.
+ */
+int server_set_route_priority(Server *server, method_t method, path_t path, priority_t priority);
+
+
+/**
+ * @brief Sets the default deadline of requests.
+ *
+ * A request's deadline counts from the moment it is read. Its budget is the
+ * route's timeout if set (server_set_route_timeout()), else this default; a
+ * client may shorten it with an SERVER_TIMEOUT_HEADER header (in ms).
+ * Requests still queued at their deadline are dropped with a 503 without
+ * running the handler, and a response produced after it is replaced by a
+ * 504. Handlers can read their remaining budget with cx_request_remaining_ms().
+ *
+ * @param server     Pointer to the Server instance.
+ * @param timeout_ms The deadline in milliseconds, or 0 for none.
+ */
+void server_set_request_timeout(Server *server, long timeout_ms);
+
+
+/**
+ * @brief Overrides the request deadline of a single route.
+ *
+ * @param server     Pointer to the Server instance.
+ * @param method     The HTTP method of the route.
+ * @param path       The URL path of the route.
+ * @param timeout_ms The deadline in milliseconds, or 0 to inherit the server default.
+ *
+ * @return 1 on success, 0 if the route does not exist or the timeout is negative.
+ */
+int server_set_route_timeout(Server *server, method_t method, path_t path, long timeout_ms);
+
+
+/**
+ * @brief Starts a graceful drain of the server.
+ *
+ * Readiness drops at once (see server_is_ready()). New connections are still
+ * accepted for the drain delay, so load balancers polling a health endpoint
+ * have time to notice, then the listening socket is closed. Every response sent
+ * while draining carries "Connection: close" and ends its connection, idle
+ * keep-alive connections are closed, and the server stops once all connections
+ * are gone or the drain timeout has passed. SIGTERM calls this from the event loop.
+ * Safe to call from a handler, or from another thread while the server runs.
+ *
+ * @param server Pointer to the Server instance.
+ */
+void server_drain(Server *server);
+
+
+/**
+ * @brief Hands the server over to a new process running the binary on disk.
+ *
+ * The executable is started again with the same arguments and inherits the
+ * listening sockets of every server running in the process, so no port becomes
+ * unbound. Once its servers have taken every one of them, the new process
+ * reports back and all of them drain (see server_drain()); if it fails to start, they keep serving. A
+ * server started with an inherited socket uses it instead of binding. SIGUSR2
+ * calls this from the event loop.
+ *
+ * @param server Pointer to the Server instance.
+ * @return 1 if the new process was started, 0 otherwise (including when an
+ *         upgrade or a drain is already under way).
+ */
+int server_upgrade(Server *server);
+
+
+/**
+ * @brief Reports this process ready to the one it takes over from, if any.
+ *
+ * The report is sent on its own once every handed-down socket has been taken
+ * by a started server. Call this when the new configuration dropped some of
+ * the old endpoints, after every server has been created: their sockets are
+ * closed and the old process drains.
+ */
+void server_upgrade_ready(void);
+
+
+/**
+ * @brief Tells whether the server wants new traffic.
+ *
+ * Meant for readiness endpoints: it is 1 once server_start() runs its loop and
+ * drops to 0 as soon as a drain starts, ahead of the listener closing.
+ *
+ * @param server Pointer to the Server instance.
+ * @return 1 if ready, 0 otherwise.
+ */
+int server_is_ready(const Server *server);
+
+
+/**
+ * @brief Sets the timing of graceful drains.
+ *
+ * @param server     Pointer to the Server instance.
+ * @param delay_ms   How long new connections are still accepted after readiness drops.
+ * @param timeout_ms How long in-flight work gets once accepting stopped (default
+ *                   SERVER_DRAIN_TIMEOUT_MS); connections left after it are closed.
+ */
+void server_set_drain(Server *server, long delay_ms, long timeout_ms);
+
+
+/**
+ * @brief Makes the loop busy poll for a while after activity before blocking.
+ *
+ * For latency-critical services that can spare a core: after each event the
+ * loop polls with zero-timeout select() calls for `spin_us`, so the next
+ * request is picked up without a sleep and wakeup. Sockets also get
+ * SO_BUSY_POLL (and SO_PREFER_BUSY_POLL), which lets the kernel poll the
+ * device queue when net.core.busy_poll is enabled. Call before server_start().
+ *
+ * @param server   Pointer to the Server instance.
+ * @param spin_us  How long to spin after the last activity, 0 to turn busy polling off.
+ * @param priority SCHED_FIFO priority of the loop thread while it runs (1-99),
+ *                 or 0 to keep the normal scheduler. Needs CAP_SYS_NICE and a
+ *                 core to spare; ignored with a single CPU online.
+ * @return 1 on success, 0 if an argument is out of range.
+ */
+int server_set_busy_poll(Server *server, long spin_us, int priority);
+
+
+/**
+ * @brief Sets the slow-client protections of the server.
+ *
+ * Client sockets are non-blocking: what a client does not read right away is
+ * buffered per connection and written as it catches up, so a slow reader no
+ * longer holds up the event loop. Response bodies are sent from in place (or
+ * from the cache's memfd) rather than copied, and do not count: a connection
+ * whose copied unread bytes would exceed `max_output` is dropped. Once per tick, connections that sent their
+ * request or read their responses below the minimum rates over `window_ms`
+ * are closed as well; a freshly accepted connection that sends nothing counts
+ * as a slow upload. Idle keep-alive connections are not affected.
+ *
+ * The defaults are SERVER_MAX_OUTPUT, no minimum rates and SERVER_RATE_WINDOW_MS.
+ * Changes apply to connections accepted afterwards. In static memory budget
+ * mode nothing is buffered: writes wait up to OUTPUT_STALL_MS for the client.
+ *
+ * @param server Pointer to the Server instance.
+ * @param limits The limits (a window of 0 keeps the default).
+ */
+void server_set_transfer_limits(Server *server, const TransferLimits *limits);
+
+
+/**
+ * @brief Caps the number of requests a route may have in flight (a bulkhead).
+ *
+ * A request counts as in flight from the moment it is read until its response
+ * is sent. Requests beyond the cap get an immediate 503, so a route stuck on a
+ * slow dependency cannot fill the pending queue and delay every other route.
+ *
+ * @param server        Pointer to the Server instance.
+ * @param method        The HTTP method of the route.
+ * @param path          The URL path of the route.
+ * @param max_in_flight The cap, or 0 to remove it.
+ *
+ * @return 1 on success, 0 if the route does not exist or the cap is negative.
+ */
+int server_set_route_max_in_flight(Server *server, method_t method, path_t path, int max_in_flight);
+
+
+/**
+ * @brief Reads the bulkhead counters of a route.
+ *
+ * @param server Pointer to the Server instance.
+ * @param method The HTTP method of the route.
+ * @param path   The URL path of the route.
+ * @param stats  Filled with the route's counters.
+ *
+ * @return 1 on success, 0 if the route does not exist.
+ */
+int server_route_stats(Server *server, method_t method, path_t path, RouteStats *stats);
+
+
+/**
+ * @brief Sets the size limits of the server's response cache.
+ *
+ * @param server          Pointer to the Server instance.
+ * @param max_bytes       Upper bound on the total size of cached bodies.
+ * @param memfd_threshold Bodies at least this large are kept in a sealed memfd and
+ *                        served with sendfile() (Linux only). 0 keeps every body in memory.
+ */
+void server_set_cache_limits(Server *server, size_t max_bytes, size_t memfd_threshold);
+
+
+/**
+ * @brief Returns the memory pressure level the server currently applies.
+ *
+ * The event loop samples PSI and cgroup memory usage every PRESSURE_SAMPLE_MS and
+ * shrinks the response cache and the buffer pool as pressure rises.
+ *
+ * @param server Pointer to the Server instance.
+ * @return The pressure level.
+ */
+pressure_level_t server_memory_pressure(const Server *server);
+
+
+/**
+ * @brief Limits how much of the server a single client can use.
+ *
+ * Connections over the per-IP or per-prefix cap (/24 for IPv4, /64 for IPv6)
+ * are refused with a 429 at accept
+ * time, and requests beyond an IP's token bucket are answered with a 429
+ * without running any handler. Call before server_start().
+ *
+ * @param server Pointer to the Server instance.
+ * @param limits The limits (0 disables an individual limit), or NULL to disable rate limiting.
+ * @return 1 on success, 0 on allocation failure.
+ */
+int server_set_rate_limits(Server *server, const RateLimits *limits);
+
+
+/**
+ * @brief Enables or disables the adaptive limit on requests in flight.
+ *
+ * Requests read during one pass of the event loop are served one after the
+ * other, so later ones wait for earlier ones. The server measures each
+ * request's latency from arrival to response and adjusts how many it admits
+ * per pass: the limit grows while latency stays near its baseline and shrinks
+ * as queueing pushes latency up. Requests over the limit get an immediate 503.
+ *
+ * @param server    Pointer to the Server instance.
+ * @param min_limit Lower bound of the limit.
+ * @param max_limit Upper bound of the limit (and starting point), or 0 to disable.
+ */
+void server_set_adaptive_concurrency(Server *server, int min_limit, int max_limit);
+
+
+/**
+ * @brief Returns the current adaptive concurrency limit.
+ *
+ * @param server Pointer to the Server instance.
+ * @return The limit, or 0 if adaptive concurrency is disabled.
+ */
+int server_concurrency_limit(const Server *server);
+
+
+/**
+ * @brief Enables or disables shedding of requests that waited too long in the queue.
+ *
+ * Requests read from clients wait in a queue until the event loop serves them.
+ * With shedding enabled, a request that waited longer than `interval_us` is
+ * answered with a 503 instead of being served. If the queue stays above
+ * `target_us` for a whole interval, the server counts as overloaded: the limit
+ * drops to twice `target_us` and the queue is served newest first, so fresh
+ * requests are answered quickly rather than everyone timing out.
+ *
+ * @param server      Pointer to the Server instance.
+ * @param target_us   Acceptable standing queue delay in microseconds, or 0 to disable.
+ * @param interval_us Observation interval in microseconds.
+ */
+void server_set_queue_shedding(Server *server, long long target_us, long long interval_us);
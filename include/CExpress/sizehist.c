@@ -0,0 +1,81 @@
+/**
+ * @file sizehist.c
+ * @brief Implementation of the response size histogram.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-26
+ */
+
+#include "sizehist.h"
+
+
+/**
+ * @brief Maps a size to its bucket.
+ *
+ * Bucket 0 holds sizes below 2^SIZE_HIST_MIN_SHIFT; every power of two above it
+ * is split into SIZE_HIST_SUB_BUCKETS equal ranges.
+ */
+static int bucket_of(size_t size) {
+    if (size < ((size_t)1 << SIZE_HIST_MIN_SHIFT)) {
+        return 0;
+    }
+    if (size >= ((size_t)1 << SIZE_HIST_MAX_SHIFT)) {
+        return SIZE_HIST_BUCKETS - 1;
+    }
+    int shift = 63 - __builtin_clzll(size);
+    int sub = (size >> (shift - 2)) & (SIZE_HIST_SUB_BUCKETS - 1);
+    return (shift - SIZE_HIST_MIN_SHIFT) * SIZE_HIST_SUB_BUCKETS + sub + 1;
+}
+
+
+/**
+ * @brief Returns the exclusive upper bound of a bucket (every size in it is smaller).
+ */
+static size_t bucket_limit(int bucket) {
+    if (bucket == 0) {
+        return (size_t)1 << SIZE_HIST_MIN_SHIFT;
+    }
+    if (bucket == SIZE_HIST_BUCKETS - 1) {
+        return (size_t)1 << SIZE_HIST_MAX_SHIFT;
+    }
+    int shift = (bucket - 1) / SIZE_HIST_SUB_BUCKETS + SIZE_HIST_MIN_SHIFT;
+    int sub = (bucket - 1) % SIZE_HIST_SUB_BUCKETS;
+    return (size_t)(SIZE_HIST_SUB_BUCKETS + sub + 1) << (shift - 2);
+}
+
+
+/**
+ * @brief Records one observed size, halving all counts once enough have accumulated.
+ */
+void size_hist_record(SizeHistogram *hist, size_t size) {
+    if (hist->total >= SIZE_HIST_DECAY) {
+        hist->total = 0;
+        for (int i = 0; i < SIZE_HIST_BUCKETS; i++) {
+            hist->counts[i] /= 2;
+            hist->total += hist->counts[i];
+        }
+    }
+    hist->counts[bucket_of(size)]++;
+    hist->total++;
+}
+
+
+/**
+ * @brief Returns the upper bound of the bucket holding the `percent`th percentile.
+ *
+ * @return The size, or 0 if fewer than SIZE_HIST_MIN_SAMPLES sizes were recorded.
+ */
+size_t size_hist_percentile(const SizeHistogram *hist, int percent) {
+    if (hist->total < SIZE_HIST_MIN_SAMPLES) {
+        return 0;
+    }
+    unsigned target = (hist->total * (unsigned)percent + 99) / 100;
+    unsigned seen = 0;
+    for (int i = 0; i < SIZE_HIST_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= target) {
+            return bucket_limit(i);
+        }
+    }
+    return bucket_limit(SIZE_HIST_BUCKETS - 1);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file sizehist.h
+ * @brief Compact histogram of response sizes used to presize response buffers.
+ *
+ * Every route records the size of the bodies its handler returns. Buckets are
+ * log-linear (four per power of two), so the size a percentile maps to is never
+ * more than 25% above the sizes it covers. Counts are halved periodically, so
+ * the histogram follows a route whose responses change size over time.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-26
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// User defined constants
+#define SIZE_HIST_MIN_SHIFT 6      // sizes below 2^6 bytes share the first bucket
+#define SIZE_HIST_MAX_SHIFT 24     // sizes from 2^24 bytes up share the last bucket
+#define SIZE_HIST_SUB_BUCKETS 4    // buckets per power of two
+#define SIZE_HIST_BUCKETS ((SIZE_HIST_MAX_SHIFT - SIZE_HIST_MIN_SHIFT) * SIZE_HIST_SUB_BUCKETS + 2)
+#define SIZE_HIST_DECAY 1024       // counts are halved when this many samples accumulated
+#define SIZE_HIST_MIN_SAMPLES 8    // fewer samples than this give no estimate
+
+
+/**
+ * @struct SizeHistogram
+ * @brief Decaying histogram of observed sizes.
+ */
+typedef struct {
+    uint16_t counts[SIZE_HIST_BUCKETS];
+    uint16_t total;           // sum of `counts`
+} SizeHistogram;
+
+
+/**
+ * @brief Records one observed size.
+ *
+ * @param hist The histogram.
+ * @param size The size in bytes.
+ */
+void size_hist_record(SizeHistogram *hist, size_t size);
+
+
+/**
+ * @brief Returns a size at least as large as `percent`% of the recorded sizes.
+ *
+ * @param hist    The histogram.
+ * @param percent The percentile (1-100).
+ * @return The upper bound of the percentile's bucket, or 0 if too few sizes were recorded.
+ */
+size_t size_hist_percentile(const SizeHistogram *hist, int percent);
@@ -0,0 +1,278 @@
+/**
+ * @file upgrade.c
+ * @brief Implementation of listener handover to a newly exec'd process.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#include "upgrade.h"
+#include "listener.h"
+#include "utils.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+
+
+#define UPGRADE_MAX_ARGS 64     // arguments passed on to the new process
+#define UPGRADE_FD_SCAN 1024    // descriptors below this are closed in the new process
+#define UPGRADE_MAX_FDS 128     // listening sockets handed down at most
+#define UPGRADE_MAX_ENV 1024    // environment variables passed on to the new process
+
+
+extern char **environ;
+
+static int inherited[UPGRADE_MAX_FDS];  // handed-down sockets not taken yet, -1 once taken
+static int inherited_count = -1;        // -1 until the environment has been read
+static pthread_mutex_t inherited_lock = PTHREAD_MUTEX_INITIALIZER; // servers start on their own threads
+
+
+/**
+ * @brief Reads the arguments the current process was started with.
+ *
+ * @param buf  Receives the NUL-separated arguments.
+ * @param size Size of `buf`.
+ * @param argv Receives pointers into `buf`, NULL-terminated.
+ * @return 1 on success, 0 on failure.
+ */
+static int read_cmdline(char *buf, size_t size, char *argv[UPGRADE_MAX_ARGS + 1]) {
+    FILE *cmdline = fopen("/proc/self/cmdline", "r");
+    if (!cmdline) {
+        return 0;
+    }
+    size_t len = fread(buf, 1, size - 1, cmdline);
+    fclose(cmdline);
+    if (len == 0) {
+        return 0;
+    }
+    buf[len] = '\0';
+
+    int argc = 0;
+    for (size_t i = 0; i < len && argc < UPGRADE_MAX_ARGS; i += strlen(buf + i) + 1) {
+        argv[argc++] = buf + i;
+    }
+    argv[argc] = NULL;
+    return 1;
+}
+
+
+/**
+ * @brief Finds the path of the running executable.
+ *
+ * A deploy usually replaces the file: /proc/self/exe then names the old,
+ * deleted binary, and it is the file now at that path that must be started.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+static int read_exe_path(char *path, size_t size) {
+    ssize_t len = readlink("/proc/self/exe", path, size - 1);
+    if (len <= 0) {
+        return 0;
+    }
+    path[len] = '\0';
+    const char *deleted = " (deleted)";
+    size_t suffix = strlen(deleted);
+    if ((size_t)len > suffix && strcmp(path + len - suffix, deleted) == 0) {
+        path[len - suffix] = '\0';
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Builds the environment of the new process.
+ *
+ * Done before fork(): the process may be multithreaded, and only
+ * async-signal-safe calls are allowed between fork() and exec. The array is
+ * static, so an upgrade does not allocate; upgrades are serialized by the caller.
+ *
+ * @param listen_fds Receives the UPGRADE_LISTEN_FD_ENV entry.
+ * @param ready_fd   Receives the UPGRADE_READY_FD_ENV entry.
+ * @return The NULL-terminated environment, or NULL if it has more than UPGRADE_MAX_ENV variables.
+ */
+static char **build_env(const int *fds, int count, int ready, char *listen_fds, size_t listen_size,
+                        char *ready_fd, size_t ready_size) {
+    size_t used = snprintf(listen_fds, listen_size, "%s=", UPGRADE_LISTEN_FD_ENV);
+    for (int i = 0; i < count && i < UPGRADE_MAX_FDS; i++) {
+        used += snprintf(listen_fds + used, listen_size - used, i ? ",%d" : "%d", fds[i]);
+    }
+    snprintf(ready_fd, ready_size, "%s=%d", UPGRADE_READY_FD_ENV, ready);
+
+    static char *envp[UPGRADE_MAX_ENV + 3];
+    size_t out = 0;
+    for (size_t i = 0; environ[i]; i++) {
+        if (out == UPGRADE_MAX_ENV) {
+            return NULL;
+        }
+        // Values left from an earlier upgrade are replaced.
+        if (strncmp(environ[i], UPGRADE_LISTEN_FD_ENV "=", strlen(UPGRADE_LISTEN_FD_ENV) + 1) != 0
+            && strncmp(environ[i], UPGRADE_READY_FD_ENV "=", strlen(UPGRADE_READY_FD_ENV) + 1) != 0) {
+            envp[out++] = environ[i];
+        }
+    }
+    envp[out++] = listen_fds;
+    envp[out++] = ready_fd;
+    envp[out] = NULL;
+    return envp;
+}
+
+
+/**
+ * @brief Starts the new process of an upgrade.
+ *
+ * @return Read end of the readiness pipe, or -1 on failure.
+ */
+int upgrade_spawn(const int *fds, int count, pid_t *pid) {
+    static char args[4096];
+    char *argv[UPGRADE_MAX_ARGS + 1];
+    char path[4096];
+    if (!read_cmdline(args, sizeof(args), argv) || !read_exe_path(path, sizeof(path))) {
+        fprintf(stderr, "Cannot find the executable or its arguments. Upgrade aborted.\n");
+        return -1;
+    }
+
+    int ready[2];
+    if (pipe(ready) == -1) {
+        perror("pipe failed. Upgrade aborted.");
+        return -1;
+    }
+    fcntl(ready[0], F_SETFD, FD_CLOEXEC);
+
+    static char listen_fds[32 + 16 * UPGRADE_MAX_FDS];
+    char ready_fd[48];
+    char **envp = build_env(fds, count, ready[1], listen_fds, sizeof(listen_fds), ready_fd, sizeof(ready_fd));
+    if (!envp) {
+        fprintf(stderr, "More than %d environment variables. Upgrade aborted.\n", UPGRADE_MAX_ENV);
+        close(ready[0]);
+        close(ready[1]);
+        return -1;
+    }
+
+    *pid = fork();
+    if (*pid == -1) {
+        perror("fork failed. Upgrade aborted.");
+        close(ready[0]);
+        close(ready[1]);
+        return -1;
+    }
+    if (*pid == 0) {
+        // New process: keep only the listeners, the readiness pipe and stdio.
+        for (int fd = 3; fd < UPGRADE_FD_SCAN; fd++) {
+            int keep = fd == ready[1];
+            for (int i = 0; i < count; i++) {
+                keep |= fd == fds[i];
+            }
+            if (!keep) {
+                close(fd);
+            }
+        }
+
+        // Only async-signal-safe calls from here: other threads may have held locks at fork().
+        for (int i = 0; i < count && i < UPGRADE_MAX_FDS; i++) {
+            fcntl(fds[i], F_SETFD, 0); // listeners are close-on-exec
+        }
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL); // the loop thread's blocked signals survive exec
+        execve(path, argv, envp);
+        _exit(127); // the parent sees the readiness pipe close and aborts the upgrade
+    }
+
+    close(ready[1]);
+    fprintf(stderr, "Upgrade: started process %d.\n", (int)*pid);
+    return ready[0];
+}
+
+
+/**
+ * @brief Parses a descriptor number from the environment and clears the variable.
+ *
+ * @return The descriptor, or -1 if the variable is unset or invalid.
+ */
+static int take_env_fd(const char *name) {
+    const char *value = getenv(name);
+    if (!value) {
+        return -1;
+    }
+    char *end;
+    long fd = strtol(value, &end, 10);
+    unsetenv(name);
+    if (*end != '\0' || fd < 3 || fd >= UPGRADE_FD_SCAN || fcntl((int)fd, F_GETFD) == -1) {
+        return -1;
+    }
+    return (int)fd;
+}
+
+
+/**
+ * @brief Reads the handed-down sockets from the environment, once.
+ */
+static void upgrade_load(void) {
+    if (inherited_count != -1) {
+        return;
+    }
+    inherited_count = 0;
+
+    const char *value = getenv(UPGRADE_LISTEN_FD_ENV);
+    while (value && *value && inherited_count < UPGRADE_MAX_FDS) {
+        char *end;
+        long fd = strtol(value, &end, 10);
+        if (end == value || fd < 3 || fd >= UPGRADE_FD_SCAN || fcntl((int)fd, F_GETFD) == -1) {
+            break;
+        }
+        fcntl((int)fd, F_SETFD, FD_CLOEXEC);
+        inherited[inherited_count++] = (int)fd;
+        value = (*end == ',') ? end + 1 : end;
+    }
+    unsetenv(UPGRADE_LISTEN_FD_ENV);
+}
+
+
+/**
+ * @brief Takes over the listening socket an upgrading process handed down for an address.
+ *
+ * @return The socket, or -1 if none was inherited for `addr`.
+ */
+int upgrade_inherited_listener(const struct sockaddr *addr, socklen_t len) {
+    pthread_mutex_lock(&inherited_lock);
+    upgrade_load();
+    int fd = listener_take(inherited, inherited_count, addr, len);
+    pthread_mutex_unlock(&inherited_lock);
+    return fd;
+}
+
+
+/**
+ * @brief Tells the upgrading process, if any, that this one now serves.
+ */
+void upgrade_notify_ready(int force) {
+    pthread_mutex_lock(&inherited_lock);
+    upgrade_load();
+    int left = 0;
+    for (int i = 0; i < inherited_count; i++) {
+        left += inherited[i] != -1;
+    }
+    if (left > 0 && !force) {
+        pthread_mutex_unlock(&inherited_lock);
+        return; // a server not created yet may still take its socket
+    }
+    // Endpoints the new configuration no longer listens on go away with the old process.
+    for (int i = 0; i < inherited_count; i++) {
+        if (inherited[i] != -1) {
+            close(inherited[i]);
+            inherited[i] = -1;
+        }
+    }
+
+    int fd = take_env_fd(UPGRADE_READY_FD_ENV);
+    pthread_mutex_unlock(&inherited_lock);
+    if (fd == -1) {
+        return;
+    }
+    char byte = 1;
+    if (write(fd, &byte, 1) != 1) {
+        perror("write failed. Upgrading process not notified.");
+    }
+    close(fd);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file upgrade.h
+ * @brief Zero-downtime binary upgrades by handing the listening socket to a new process.
+ *
+ * The running server forks and execs the executable at its own path (the
+ * binary on disk, so a freshly deployed one) with the same arguments. The
+ * listening sockets are inherited across exec and described to the new process
+ * in UPGRADE_LISTEN_FD_ENV, so no endpoint ever becomes unbound. The new process
+ * reports through a pipe (UPGRADE_READY_FD_ENV) once every handed-down socket
+ * has been taken by a running server, or when told to; only then does the old
+ * one stop accepting and drain. If the new process fails to
+ * start, the pipe closes without a report and the old one keeps serving.
+ *
+ * @author Karl-Alexandre Michaud
+ * @date 2025-09-30
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+
+// User defined constants
+#define UPGRADE_LISTEN_FD_ENV "CEXPRESS_LISTEN_FD"   // inherited listening sockets of the new process, comma-separated
+#define UPGRADE_READY_FD_ENV "CEXPRESS_READY_FD"     // pipe the new process reports readiness on
+
+
+/**
+ * @brief Starts the new process of an upgrade.
+ *
+ * Every other descriptor of the calling process is closed in the new one.
+ *
+ * @param fds   The listening sockets to hand over.
+ * @param count Number of sockets.
+ * @param pid   Receives the process id of the new process.
+ * @return Read end of the readiness pipe (one byte arrives once the new process
+ *         serves, end-of-file if it died first), or -1 if it could not be started.
+ */
+int upgrade_spawn(const int *fds, int count, pid_t *pid);
+
+
+/**
+ * @brief Takes over the listening socket an upgrading process handed down for an address.
+ *
+ * The environment variable is read on the first call and then cleared, so it
+ * is not passed on again. Each socket is handed out once.
+ *
+ * @param addr The address the server listens on.
+ * @param len  Length of the address.
+ * @return The socket, or -1 if none was inherited for `addr`.
+ */
+int upgrade_inherited_listener(const struct sockaddr *addr, socklen_t len);
+
+
+/**
+ * @brief Tells the upgrading process, if any, that this one now serves.
+ *
+ * Without `force`, nothing happens while a handed-down socket is still
+ * untaken: a server created later may claim it. With `force`, the untaken
+ * ones are closed (the endpoints the new configuration dropped) and the
+ * upgrading process is told anyway. It is told once.
+ *
+ * @param force 1 to report even if handed-down sockets are left.
+ */
+void upgrade_notify_ready(int force);
@@ -13,6 +13,9 @@
 
 #include "utils.h"
 
+#include <sys/socket.h>
+#include <netinet/in.h>
+
 
 
 
@@ -178,6 +181,55 @@ fail:
 }
 
 
+/**
+ * @brief Splits a string into tokens allocated from an arena.
+ *
+ * Counts the tokens first so the array is allocated once at its final size,
+ * which avoids growing it inside the arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param buffer The input string to split.
+ * @param buff_size The length of the buffer.
+ * @param sep The separator character.
+ * @return A NULL-terminated array of strings or NULL on failure.
+ */
+char **split_arena(Arena *arena, const char *buffer, size_t buff_size, const char sep) {
+    if (!arena || !buffer || buff_size == 0) {
+        return NULL;
+    }
+
+    size_t count = 1;
+    for (size_t i = 0; i < buff_size; i++) {
+        if (buffer[i] == sep) {
+            count++;
+        }
+    }
+    if (buffer[buff_size - 1] == sep) {
+        count--; // split() drops an empty trailing token
+    }
+
+    char **split_lst = arena_alloc(arena, (count + 1) * sizeof(char *));
+    if (!split_lst) {
+        return NULL;
+    }
+
+    size_t n = 0;
+    size_t wrd_start = 0;
+    for (size_t i = 0; i <= buff_size && n < count; i++) {
+        if (i == buff_size || buffer[i] == sep) {
+            split_lst[n] = arena_strndup(arena, buffer + wrd_start, i - wrd_start);
+            if (!split_lst[n]) {
+                return NULL;
+            }
+            n++;
+            wrd_start = i + 1;
+        }
+    }
+    split_lst[n] = NULL;
+    return split_lst;
+}
+
+
 /**
  * @brief Extracts individual lines from an HTTP header.
  *
@@ -332,3 +384,157 @@ char *add_http_header(const char *buffer, size_t buff_size) {
     return response;
 }
 
+
+/**
+ * @brief Looks up the value of a header field in a raw HTTP request.
+ *
+ * Walks the request line by line without allocating. The request line itself is
+ * skipped, and scanning stops at the blank line terminating the header block.
+ *
+ * @param header   The raw HTTP request string.
+ * @param key      The field name to look for, matched case-insensitively.
+ * @param out      Buffer receiving the NUL-terminated value.
+ * @param out_size Size of `out` in bytes. Longer values are truncated.
+ *
+ * @return 1 if the field was found, 0 otherwise.
+ */
+int get_header_value(const char *header, const char *key, char *out, size_t out_size) {
+    if (!header || !key || !out || out_size == 0) {
+        return 0;
+    }
+
+    size_t key_len = strlen(key);
+    const char *line = strstr(header, "\r\n"); // skip the request line
+    while (line) {
+        line += 2;
+        if (line[0] == '\r' || line[0] == '\0') {
+            break; // blank line -> end of header block
+        }
+
+        const char *line_end = strstr(line, "\r\n");
+        if (!line_end) {
+            line_end = line + strlen(line);
+        }
+
+        if ((size_t)(line_end - line) > key_len && line[key_len] == ':'
+            && strncasecmp(line, key, key_len) == 0) {
+            const char *value = line + key_len + 1;
+            while (value < line_end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            size_t val_len = line_end - value;
+            if (val_len >= out_size) {
+                val_len = out_size - 1;
+            }
+            memcpy(out, value, val_len);
+            out[val_len] = '\0';
+            return 1;
+        }
+        line = (*line_end == '\0') ? NULL : line_end;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Formats an HTTP/1.1 200 response header into a caller-provided buffer.
+ *
+ * Unlike `add_http_header()`, this does not copy the body, which lets callers
+ * send the header and body with a single vectored write.
+ *
+ * @param out            Destination buffer.
+ * @param out_size       Size of `out` in bytes.
+ * @param content_length Length of the body that will follow the header.
+ * @param extra_headers  Additional "Name: value\r\n" lines to emit, or NULL.
+ *
+ * @return The length of the formatted header, or 0 if it did not fit in `out`.
+ */
+size_t format_http_header(char *out, size_t out_size, size_t content_length, const char *extra_headers) {
+    int len = snprintf(out, out_size,
+                       "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: text/plain\r\n"
+                       "Content-Length: %zu\r\n"
+                       "%s"
+                       "\r\n",
+                       content_length, extra_headers ? extra_headers : "");
+    if (len < 0 || (size_t)len >= out_size) {
+        return 0;
+    }
+    return (size_t)len;
+}
+
+
+/**
+ * @brief Writes a whole buffer to a file descriptor, retrying on short writes and EINTR.
+ *
+ * @param fd  The destination file descriptor.
+ * @param buf The data to write.
+ * @param len Number of bytes to write.
+ *
+ * @return The number of bytes written (`len`) on success, or -1 on error.
+ */
+ssize_t write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    size_t left = len;
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        left -= n;
+    }
+    return (ssize_t)len;
+}
+
+
+/**
+ * @brief Returns the current monotonic time in milliseconds.
+ *
+ * @return Milliseconds elapsed since an arbitrary fixed point (CLOCK_MONOTONIC).
+ */
+long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+/**
+ * @brief Returns the current monotonic time in microseconds.
+ *
+ * @return Microseconds elapsed since the same fixed point as now_ms().
+ */
+long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/**
+ * @brief Finds the TCP port a socket is bound to.
+ *
+ * @return The port, or -1 if `fd` is not a bound IPv4 stream socket.
+ */
+int socket_port(int fd, int *listening) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int type = 0;
+    socklen_t type_len = sizeof(type);
+    if (getsockname(fd, (struct sockaddr *)&addr, &addr_len) == -1 || addr.sin_family != AF_INET
+        || getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_len) == -1 || type != SOCK_STREAM
+        || addr.sin_port == 0) {
+        return -1;
+    }
+    if (listening) {
+        socklen_t opt_len = sizeof(*listening);
+        if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, listening, &opt_len) == -1) {
+            *listening = 0;
+        }
+    }
+    return ntohs(addr.sin_port);
+}
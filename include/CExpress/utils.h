@@ -16,7 +16,12 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <strings.h>
 #include <regex.h>
+#include <time.h>
+#include <errno.h>
+
+#include "arena.h"
 
 
 
@@ -46,6 +51,21 @@ char **extract_key_value(const char *buffer);
 char **split(const char *buffer, size_t buff_size, const char sep);
 
 
+/**
+ * @brief Splits a string into tokens allocated from an arena.
+ *
+ * Same contract as split(), but the array and the tokens live in `arena` and are
+ * released together by arena_reset(); nothing must be freed individually.
+ *
+ * @param arena The arena to allocate from.
+ * @param buffer The input string to split.
+ * @param buff_size The size of the buffer.
+ * @param sep The character separator to use for splitting.
+ * @return A NULL-terminated array of strings containing the tokens, or NULL on failure.
+ */
+char **split_arena(Arena *arena, const char *buffer, size_t buff_size, const char sep);
+
+
 
 
 /**
@@ -78,3 +98,73 @@ char **extract_lines(const char *buffer, size_t buff_size);
  * @note Only HTTP/1.1 is supported. The function assumes the response is text/plain.
  */
 char *add_http_header(const char *buffer, size_t buff_size);
+
+
+/**
+ * @brief Looks up the value of a header field in a raw HTTP request.
+ *
+ * Field names are matched case-insensitively and leading whitespace is stripped
+ * from the value. Scanning stops at the blank line that ends the header block.
+ *
+ * @param header   The raw HTTP request string.
+ * @param key      The field name to look for (e.g. "Accept-Encoding").
+ * @param out      Buffer receiving the NUL-terminated value.
+ * @param out_size Size of `out` in bytes. Longer values are truncated.
+ *
+ * @return 1 if the field was found, 0 otherwise.
+ */
+int get_header_value(const char *header, const char *key, char *out, size_t out_size);
+
+
+/**
+ * @brief Formats an HTTP/1.1 200 response header into a caller-provided buffer.
+ *
+ * @param out            Destination buffer.
+ * @param out_size       Size of `out` in bytes.
+ * @param content_length Length of the body that will follow the header.
+ * @param extra_headers  Additional "Name: value\r\n" lines to emit, or NULL.
+ *
+ * @return The length of the formatted header, or 0 if it did not fit in `out`.
+ */
+size_t format_http_header(char *out, size_t out_size, size_t content_length, const char *extra_headers);
+
+
+/**
+ * @brief Writes a whole buffer to a file descriptor, retrying on short writes and EINTR.
+ *
+ * @param fd  The destination file descriptor.
+ * @param buf The data to write.
+ * @param len Number of bytes to write.
+ *
+ * @return The number of bytes written (`len`) on success, or -1 on error.
+ */
+ssize_t write_all(int fd, const void *buf, size_t len);
+
+
+/**
+ * @brief Returns the current monotonic time in milliseconds.
+ *
+ * @return Milliseconds elapsed since an arbitrary fixed point (CLOCK_MONOTONIC).
+ */
+long long now_ms(void);
+
+
+/**
+ * @brief Returns the current monotonic time in microseconds.
+ *
+ * For measuring durations shorter than a millisecond, such as handler latency.
+ *
+ * @return Microseconds elapsed since the same fixed point as now_ms().
+ */
+long long now_us(void);
+
+
+/**
+ * @brief Finds the TCP port a socket is bound to.
+ *
+ * @param fd        The socket.
+ * @param listening Receives 1 if the socket is listening, 0 otherwise. May be NULL.
+ *
+ * @return The port, or -1 if `fd` is not a bound IPv4 stream socket.
+ */
+int socket_port(int fd, int *listening);